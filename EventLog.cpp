@@ -0,0 +1,465 @@
+#include "EventLog.h"
+
+#include <QDateTime>
+#include <QDate>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+
+#include <string.h>
+#include <algorithm>
+
+
+//*** log file header ***
+typedef struct
+{
+    char    magic[4];     // 'FPEL'
+    quint32 version;
+    quint32 eventSize;    // sizeof(t_LogEvent)
+} t_LogHeader;
+
+const char    LOG_MAGIC[4]  = { 'F', 'P', 'E', 'L' };
+const quint32 LOG_VERSION   = 1;
+
+//*** how often the log thread collects the rings ***
+const int LOG_FLUSH_MS = 100;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::EventLog
+ * @param path
+ * @param maxBytes
+ * @param keepFiles
+ * @param parent
+ */
+//*****************************************************************************
+EventLog::EventLog( QString path, qint64 maxBytes, int keepFiles, QObject *parent ) : QThread(parent)
+{
+    path_      = path;
+    maxBytes_  = maxBytes;
+    keepFiles_ = keepFiles;
+    dropped_   = 0;
+    stop_      = 0;
+
+    if ( !path_.isEmpty() )
+    {
+        QDir().mkpath( QFileInfo( path_ ).absolutePath() );
+    }
+
+    setObjectName( "EventLog" );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::~EventLog
+ */
+//*****************************************************************************
+EventLog::~EventLog()
+{
+    if ( isRunning() )
+    {
+        stop_.storeRelease( 1 );
+
+        {
+            QMutexLocker lock( &waitMutex_ );
+            wake_.wakeAll();
+        }
+
+        wait();
+    }
+
+    file_.close();
+
+    qDeleteAll( rings_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::ring
+ * @return
+ */
+//*****************************************************************************
+EventLog::t_Ring *EventLog::ring()
+{
+t_RingRef ref;
+
+    //*** fast path - this thread already has one ***
+    if ( ringRef_.hasLocalData() ) return ringRef_.localData().ring;
+
+    ref.ring = new t_Ring;
+    ref.ring->head = 0;
+    ref.ring->tail = 0;
+
+    {
+        QMutexLocker lock( &ringsMutex_ );
+        rings_.append( ref.ring );
+        ref.id = rings_.size();
+    }
+
+    ringRef_.setLocalData( ref );
+
+    return ref.ring;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::push
+ * @param ev
+ */
+//*****************************************************************************
+void EventLog::push( t_LogEvent &ev )
+{
+    t_Ring *r = ring();
+
+    quint32 head = r->head.load();
+    quint32 tail = r->tail.loadAcquire();
+
+    //*** full - never wait on the log thread ***
+    if ( head - tail >= (quint32)LOG_RING_SIZE )
+    {
+        dropped_.fetchAndAddRelaxed( 1 );
+        return;
+    }
+
+    ev.time   = QDateTime::currentMSecsSinceEpoch();
+    ev.thread = ringRef_.localData().id;
+
+    r->events[head % LOG_RING_SIZE] = ev;
+    r->head.storeRelease( head + 1 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::record
+ * @param type
+ * @param key
+ * @param weight
+ * @param seq
+ * @param day
+ */
+//*****************************************************************************
+void EventLog::record( LogEventType type, qint32 key, float weight, quint32 seq, qint64 day )
+{
+    record( type, key, weight, seq, day, nullptr, 0 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::record
+ * @param type
+ * @param key
+ * @param weight
+ * @param seq
+ * @param day
+ * @param text - UTF-8, cut to LOG_TEXT_MAX bytes on a character boundary
+ * @param len
+ */
+//*****************************************************************************
+void EventLog::record( LogEventType type, qint32 key, float weight, quint32 seq, qint64 day,
+                       const char *text, int len )
+{
+t_LogEvent ev;
+
+    memset( &ev, 0, sizeof(ev) );
+    ev.type   = type;
+    ev.key    = key;
+    ev.weight = weight;
+    ev.seq    = seq;
+    ev.day    = day;
+
+    if ( text && len > 0 )
+    {
+        //*** cut short - back up to the start of the character that doesn't fit ***
+        if ( len > LOG_TEXT_MAX )
+        {
+            len = LOG_TEXT_MAX;
+            while ( len > 0 && ( (uchar)text[len] & 0xc0 ) == 0x80 ) len--;
+        }
+
+        memcpy( ev.text, text, len );
+    }
+
+    push( ev );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::record
+ * @param type
+ * @param key
+ * @param weight
+ * @param seq
+ * @param day
+ * @param text - encoded straight into the event, no temporary string
+ */
+//*****************************************************************************
+void EventLog::record( LogEventType type, qint32 key, float weight, quint32 seq, qint64 day,
+                       const QString &text )
+{
+t_LogEvent ev;
+int len = 0;
+
+    memset( &ev, 0, sizeof(ev) );
+    ev.type   = type;
+    ev.key    = key;
+    ev.weight = weight;
+    ev.seq    = seq;
+    ev.day    = day;
+
+    //*** UTF-16 to UTF-8, whole characters only (no surrogate pairs) ***
+    for ( int i = 0; i < text.size(); i++ )
+    {
+        ushort c = text.at( i ).unicode();
+
+        if ( c < 0x80 )
+        {
+            if ( len + 1 > LOG_TEXT_MAX ) break;
+            ev.text[len++] = (char)c;
+        }
+        else if ( c < 0x800 )
+        {
+            if ( len + 2 > LOG_TEXT_MAX ) break;
+            ev.text[len++] = (char)( 0xc0 | ( c >> 6 ) );
+            ev.text[len++] = (char)( 0x80 | ( c & 0x3f ) );
+        }
+        else
+        {
+            if ( c >= 0xd800 && c <= 0xdfff ) c = '?';
+            if ( len + 3 > LOG_TEXT_MAX ) break;
+            ev.text[len++] = (char)( 0xe0 | ( c >> 12 ) );
+            ev.text[len++] = (char)( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+            ev.text[len++] = (char)( 0x80 | ( c & 0x3f ) );
+        }
+    }
+
+    push( ev );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::run
+ */
+//*****************************************************************************
+void EventLog::run()
+{
+    while ( !stop_.loadAcquire() )
+    {
+        {
+            QMutexLocker lock( &waitMutex_ );
+            if ( !stop_.loadAcquire() ) wake_.wait( &waitMutex_, LOG_FLUSH_MS );
+        }
+
+        drain();
+    }
+
+    //*** anything recorded before shutdown ***
+    drain();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::drain
+ */
+//*****************************************************************************
+void EventLog::drain()
+{
+QVector<t_Ring*> rings;
+QVector<t_LogEvent> events;
+QStringList lines;
+
+    {
+        QMutexLocker lock( &ringsMutex_ );
+        rings = rings_;
+    }
+
+    //*** take what each ring holds ***
+    for ( t_Ring *r : rings )
+    {
+        quint32 tail = r->tail.load();
+        quint32 head = r->head.loadAcquire();
+
+        for ( quint32 i = tail; i != head; i++ )
+        {
+            events.append( r->events[i % LOG_RING_SIZE] );
+        }
+
+        r->tail.storeRelease( head );
+    }
+
+    if ( events.isEmpty() ) return;
+
+    //*** threads in time order ***
+    if ( rings.size() > 1 )
+    {
+        std::stable_sort( events.begin(), events.end(),
+                          []( const t_LogEvent &a, const t_LogEvent &b ) { return a.time < b.time; } );
+    }
+
+    //*** to disk ***
+    qint64 bytes = events.size() * (qint64)sizeof(t_LogEvent);
+
+    if ( !path_.isEmpty() && openFile( bytes ) )
+    {
+        file_.write( (const char *)events.constData(), bytes );
+        file_.flush();
+    }
+
+    //*** to the window ***
+    for ( const t_LogEvent &ev : events )
+    {
+        lines.append( format( ev ) );
+    }
+
+    emit formatted( lines.join( "\n" ) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::openFile
+ * @param bytesToAdd
+ * @return
+ */
+//*****************************************************************************
+bool EventLog::openFile( qint64 bytesToAdd )
+{
+t_LogHeader hdr;
+
+    //*** full - events.fplog -> events.fplog.1 -> ... ***
+    if ( file_.isOpen() && file_.size() + bytesToAdd > maxBytes_ )
+    {
+        file_.close();
+
+        QFile::remove( QString( "%1.%2" ).arg( path_ ).arg( keepFiles_ ) );
+
+        for ( int i = keepFiles_ - 1; i >= 1; i-- )
+        {
+            QFile::rename( QString( "%1.%2" ).arg( path_ ).arg( i ), QString( "%1.%2" ).arg( path_ ).arg( i + 1 ) );
+        }
+
+        if ( keepFiles_ > 0 )
+            QFile::rename( path_, path_ + ".1" );
+        else
+            QFile::remove( path_ );
+    }
+
+    if ( file_.isOpen() ) return true;
+
+    file_.setFileName( path_ );
+
+    if ( !file_.open( QIODevice::WriteOnly | QIODevice::Append ) ) return false;
+
+    //*** new file ***
+    if ( file_.size() == 0 )
+    {
+        memcpy( hdr.magic, LOG_MAGIC, sizeof(hdr.magic) );
+        hdr.version   = LOG_VERSION;
+        hdr.eventSize = sizeof(t_LogEvent);
+
+        file_.write( (const char *)&hdr, sizeof(hdr) );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::format
+ * @param ev
+ * @return
+ */
+//*****************************************************************************
+QString EventLog::format( const t_LogEvent &ev )
+{
+    QString name = QString::fromUtf8( ev.text, qstrnlen( ev.text, LOG_TEXT_MAX ) );
+
+    switch ( ev.type )
+    {
+    case LOG_CHECKIN:
+        return QString( "CHECKIN - key: %1  name: %2  items: %3  day: %4" )
+                .arg( ev.key ).arg( name ).arg( ev.seq )
+                .arg( QDate::fromJulianDay( ev.day ).toString( "MM/dd/yyyy" ) );
+
+    case LOG_WEIGHT:
+        return QString( "FROM PI - Key: %1  name: %2  weight: %3  day: %4" )
+                .arg( ev.key ).arg( name ).arg( ev.weight )
+                .arg( QDate::fromJulianDay( ev.day ).toString() );
+
+    case LOG_DUPLICATE:
+        return QString( "Duplicate report %1 - Key: %2  weight: %3, already stored" )
+                .arg( ev.seq ).arg( ev.key ).arg( ev.weight );
+
+    case LOG_UNKNOWN_FAMILY:
+        return QString( "Unknown family %1" ).arg( ev.key );
+
+    case LOG_CONNECTED:
+        return "Connected...";
+
+    case LOG_DISCONNECTED:
+        return "Server disconnected, reconnecting...";
+
+    default:
+        return QString( "Unknown event %1" ).arg( ev.type );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief EventLog::decode
+ * @param path
+ * @param out
+ * @return
+ */
+//*****************************************************************************
+bool EventLog::decode( QString path, QTextStream &out )
+{
+QFile file( path );
+t_LogHeader hdr;
+t_LogEvent ev;
+
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        out << path << ": " << file.errorString() << "\n";
+        return false;
+    }
+
+    if ( file.read( (char *)&hdr, sizeof(hdr) ) != sizeof(hdr) ||
+         memcmp( hdr.magic, LOG_MAGIC, sizeof(hdr.magic) ) != 0 ||
+         hdr.version != LOG_VERSION || hdr.eventSize != sizeof(t_LogEvent) )
+    {
+        out << path << ": not an fpSvr event log\n";
+        return false;
+    }
+
+    while ( file.read( (char *)&ev, sizeof(ev) ) == sizeof(ev) )
+    {
+        out << QDateTime::fromMSecsSinceEpoch( ev.time ).toString( "yyyy-MM-dd hh:mm:ss.zzz" )
+            << "  " << format( ev ) << "\n";
+    }
+
+    return true;
+}
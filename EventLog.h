@@ -0,0 +1,140 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadStorage>
+#include <QAtomicInteger>
+#include <QVector>
+#include <QFile>
+
+class QTextStream;
+
+
+//*** event types ***
+enum LogEventType
+{
+    LOG_CHECKIN = 1,        // key, seq = items, day, text = name
+    LOG_WEIGHT,             // key, weight, seq, day, text = name
+    LOG_DUPLICATE,          // key, weight, seq, day - resent report dropped
+    LOG_UNKNOWN_FAMILY,     // key - weight for a family not in the roster
+    LOG_CONNECTED,          // scale link up
+    LOG_DISCONNECTED        // scale link down
+};
+
+//*** bytes of name kept with an event (UTF-8, zero padded) ***
+const int LOG_TEXT_MAX = 32;
+
+//*** one event - fixed size, written to the log as is ***
+typedef struct
+{
+    qint64  time;                // ms since epoch
+    quint16 type;                // LogEventType
+    quint16 thread;              // ring (thread) that recorded it
+    qint32  key;
+    float   weight;
+    quint32 seq;
+    qint64  day;                 // julian day
+    char    text[LOG_TEXT_MAX];
+} t_LogEvent;
+
+//*** events per thread before new ones are dropped ***
+const int LOG_RING_SIZE = 4096;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The EventLog class
+ *
+ * Binary event log. record() copies a fixed size event into the calling
+ * thread's ring (single producer, single consumer - no locks) and returns.
+ * The log's own thread collects the rings, appends the events to the log
+ * file, rotating it by size, and formats them into text for the window.
+ * Files are read back with decode() (fpSvr --decode-log <file>).
+ */
+//*****************************************************************************
+class EventLog : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor - empty path keeps events in memory only (display) ***
+    EventLog( QString path, qint64 maxBytes, int keepFiles, QObject *parent = nullptr );
+
+    //*** destructor - writes anything left and stops the thread ***
+    ~EventLog();
+
+    //*** records an event (any thread, never blocks) ***
+    void record( LogEventType type, qint32 key, float weight = 0, quint32 seq = 0, qint64 day = 0 );
+    void record( LogEventType type, qint32 key, float weight, quint32 seq, qint64 day, const char *text, int len );
+    void record( LogEventType type, qint32 key, float weight, quint32 seq, qint64 day, const QString &text );
+
+    //*** events dropped because a ring was full ***
+    int dropped() { return dropped_.load(); }
+
+    //*** event as text (no time) ***
+    static QString format( const t_LogEvent &ev );
+
+    //*** writes a log file out as text ***
+    static bool decode( QString path, QTextStream &out );
+
+signals:
+
+    //*** formatted events, one per line ***
+    void formatted( QString lines );
+
+protected:
+
+    void run() override;
+
+private:
+
+    //*** one thread's events ***
+    typedef struct
+    {
+        t_LogEvent              events[LOG_RING_SIZE];
+        QAtomicInteger<quint32> head;   // next write (producer)
+        QAtomicInteger<quint32> tail;   // next read (log thread)
+    } t_Ring;
+
+    //*** the calling thread's ring, created on first use ***
+    t_Ring *ring();
+
+    //*** copies an event into the calling thread's ring ***
+    void push( t_LogEvent &ev );
+
+    //*** collects, writes and formats everything recorded so far ***
+    void drain();
+
+    //*** opens the log file, rotating it first if it is full ***
+    bool openFile( qint64 bytesToAdd );
+
+    QString path_;
+    qint64  maxBytes_;
+    int     keepFiles_;
+    QFile   file_;
+
+    //*** this thread's ring (a value, so QThreadStorage never deletes it) ***
+    typedef struct
+    {
+        t_Ring *ring;
+        quint16 id;
+    } t_RingRef;
+
+    //*** rings - the list only changes when a thread logs its first event ***
+    QMutex                    ringsMutex_;
+    QVector<t_Ring*>          rings_;
+    QThreadStorage<t_RingRef> ringRef_;
+
+    QAtomicInt dropped_;
+    QAtomicInt stop_;
+
+    //*** wakes the log thread early for shutdown ***
+    QMutex         waitMutex_;
+    QWaitCondition wake_;
+};
+
+#endif // EVENTLOG_H
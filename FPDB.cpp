@@ -1,10 +1,17 @@
 #include "FPDB.h"
+#include "WeightArchive.h"
 
 #include <QSqlError>
 #include <QDate>
+#include <QDateTime>
 #include <QSqlRecord>
-#include <QSqlError>
 #include <QDebug>
+#include <QThread>
+#include <QtConcurrent>
+#include <QIODevice>
+
+#include <stdio.h>
+#include <string.h>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -13,17 +20,31 @@
  * @param parent
  */
 //*****************************************************************************
-FPDB::FPDB( QString driver, QString dsn, QString label, bool isLocal, QObject *parent ) : QObject(parent)
+FPDB::FPDB( QString driver, QString dsn, QString label, bool isLocal, bool readOnly, QObject *parent ) : QObject(parent)
 {
     driver_    = driver;
     dsn_       = dsn;
     isLocal_   = isLocal;
+    readOnly_  = readOnly;
     label_     = label;
-    isReady_   = false;
+    ready_     = 0;
+    readerGen_ = 0;
     lastError_ = "No error";
-    weightTbl_ = Q_NULLPTR;
+    insertQry_ = Q_NULLPTR;
+
+    dayFindQry_   = Q_NULLPTR;
+    dayUpdateQry_ = Q_NULLPTR;
+    dayInsertQry_ = Q_NULLPTR;
 
     nextRecID_ = 1;
+    archive_   = Q_NULLPTR;
+
+    historyCache_.setMaxCost( HISTORY_CACHE_SIZE );
+    historyGen_ = 0;
+
+    //*** reader threads (and their connections) stay alive ***
+    readPool_.setMaxThreadCount( READER_POOL_SIZE );
+    readPool_.setExpiryTimeout( -1 );
 
     //*** setup access to the database ***
     setup();
@@ -39,11 +60,85 @@ FPDB::FPDB( QString driver, QString dsn, QString label, bool isLocal, QObject *p
 //*****************************************************************************
 FPDB::~FPDB()
 {
+    //*** finish any outstanding reads ***
+    readPool_.waitForDone();
+
+    //*** remove reader connections ***
+    for ( const QString &name : readerNames_ )
+    {
+        QSqlDatabase::removeDatabase( name );
+    }
+
+    delete insertQry_;
+    delete dayFindQry_;
+    delete dayUpdateQry_;
+    delete dayInsertQry_;
+
     if ( db_.isOpen() )
         db_.close();
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::reopen
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::reopen()
+{
+    //*** readers stop here, and replace their connections once it is back ***
+    ready_.storeRelease( 0 );
+    readerGen_.fetchAndAddOrdered( 1 );
+
+    delete insertQry_;
+    insertQry_ = Q_NULLPTR;
+
+    delete dayFindQry_;
+    delete dayUpdateQry_;
+    delete dayInsertQry_;
+    dayFindQry_   = Q_NULLPTR;
+    dayUpdateQry_ = Q_NULLPTR;
+    dayInsertQry_ = Q_NULLPTR;
+
+    //*** release the old connection before it is replaced ***
+    if ( db_.isOpen() ) db_.close();
+    db_ = QSqlDatabase();
+    QSqlDatabase::removeDatabase( label_ );
+
+    setup();
+
+    return isReady();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::probe
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::probe()
+{
+QSqlQuery query( db_ );
+
+    //*** sanity check ***
+    if ( !isReady() ) return false;
+
+    //*** touches the table without reading any rows (Access needs a FROM) ***
+    if ( !query.exec( QString( "select count(*) from %1 where 1 = 0" ).arg(WeightTableName) ) )
+    {
+        setError( query.lastError().text() );
+        ready_.storeRelease( 0 );
+        return false;
+    }
+
+    return true;
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
 /**
@@ -58,51 +153,66 @@ void FPDB::setup()
     //*** set name (DSN) ***
     db_.setDatabaseName( dsn_ );
 
+    //*** read only - the file must already exist, and is never changed ***
+    if ( readOnly_ && isLocal_ )
+    {
+        db_.setConnectOptions( "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000" );
+    }
+
     //*** open the database ***
     if ( !db_.open() )
     {
         //*** error opening database ***
-        lastError_ = db_.lastError().text();
+        setError( db_.lastError().text() );
         return;
     }
-    isReady_ = true;
 
-    //*** if local, check if we need to set up the database ***
-    if ( isLocal_ && db_.tables().size() == 0 )
+    //*** nothing to tune, migrate or prepare ***
+    if ( readOnly_ )
     {
-        isReady_ = createDatabase();
+        ready_.storeRelease( 1 );
+        return;
     }
 
-    if ( !isReady_ ) return;
-
-    //*** create the table model ***
-    weightTbl_ = new QSqlTableModel( this, db_ );
-    weightTbl_->setTable( WeightTableName );
-    weightTbl_->setEditStrategy( QSqlTableModel::OnManualSubmit );
-
-    weightTbl_->select();
+    //*** if local, tune the connection and bring the schema up to date ***
+    if ( isLocal_ )
+    {
+        setPragmas();
+        if ( !migrate() ) return;
+    }
 
     //*** determine next unique record ID ***
-    nextRecID_ = weightTbl_->rowCount() + 1;
+    if ( isLocal_ )
+    {
+        QSqlQuery maxQry( db_ );
+        if ( maxQry.exec( QString( "select max(%1) from %2" ).arg(ID_Field).arg(WeightTableName) ) && maxQry.next() )
+        {
+            nextRecID_ = maxQry.value( 0 ).toInt() + 1;
+        }
+    }
 
     //*** prepare the insert query ***
     QString insertStr;
     if ( isLocal_ )
     {
-        //*** for local SQLITE database ***
-        insertStr = QString( "INSERT INTO %1 ( %2, %3, %4, %5, %6 ) " )
+        //*** for local SQLITE database - resent scale reports hit the unique index and are skipped ***
+        insertStr = QString( "INSERT OR IGNORE INTO %1 ( %2, %3, %4, %5, %6, %7, %8 ) " )
                 .arg(WeightTableName)
                 .arg(ID_Field)
                 .arg(Fam_ID_Field)
                 .arg(Weight_Field)
                 .arg(Date_Field)
-                .arg(Name_Field);
-        insertStr += QString( "VALUES ( %1, %2, %3, %4, %5 )" )
+                .arg(Name_Field)
+                .arg(Session_Field)
+                .arg(Seq_Field);
+        insertStr += QString( "VALUES ( %1, %2, %3, %4, %5, %6, %7 )" )
                 .arg(ID_Bind)
                 .arg(Fam_ID_Bind)
                 .arg(Weight_Bind)
                 .arg(Date_Bind)
-                .arg(Name_Bind);
+                .arg(Name_Bind)
+                .arg(Session_Bind)
+                .arg(Seq_Bind);
     }
     else
     {
@@ -133,6 +243,85 @@ void FPDB::setup()
 
     //*** prepare the insert query ***
     insertQry_->prepare( insertStr );
+
+    //*** set last, other threads never see it half set up ***
+    ready_.storeRelease( 1 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::readerDatabase - read only connection for the calling thread
+ * @return
+ */
+//*****************************************************************************
+QSqlDatabase FPDB::readerDatabase()
+{
+    //*** nothing new is opened while the writer is down or reopening ***
+    if ( !isReady() ) return QSqlDatabase();
+
+    QString prefix = QString( "%1_reader_%2_" ).arg( label_ ).arg( (quintptr)QThread::currentThreadId() );
+    QString name   = prefix + QString::number( readerGen_.loadAcquire() );
+
+    //*** already opened by this thread (database() reopens it if it was closed) ***
+    if ( QSqlDatabase::contains( name ) ) return QSqlDatabase::database( name );
+
+    //*** opened before a reopen - this thread owns it, so it is dropped here ***
+    {
+        QMutexLocker lock( &readerMutex_ );
+
+        for ( int i=readerNames_.size()-1; i>=0; i-- )
+        {
+            if ( readerNames_[i].startsWith( prefix ) )
+            {
+                QSqlDatabase::removeDatabase( readerNames_.takeAt( i ) );
+            }
+        }
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase( driver_, name );
+    db.setDatabaseName( dsn_ );
+
+    //*** local readers never write, and wait out checkpoints ***
+    if ( isLocal_ )
+    {
+        db.setConnectOptions( "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000" );
+    }
+
+    {
+        QMutexLocker lock( &readerMutex_ );
+        readerNames_.append( name );
+    }
+
+    if ( !db.open() )
+    {
+        setError( db.lastError().text() );
+        return db;
+    }
+
+    if ( isLocal_ )
+    {
+        QSqlQuery query( db );
+        query.exec( "PRAGMA mmap_size = 67108864" );
+        query.exec( "PRAGMA cache_size = -8192" );
+    }
+
+    return db;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::setError
+ * @param error
+ */
+//*****************************************************************************
+void FPDB::setError( QString error )
+{
+    QMutexLocker lock( &errorMutex_ );
+    lastError_ = error;
 }
 
 
@@ -162,7 +351,157 @@ QString createStr;
     //*** create table that holds weights ***
     if ( !query.exec( createStr ) )
     {
-        lastError_ = query.lastError().text();
+        setError( query.lastError().text() );
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::setPragmas
+ */
+//*****************************************************************************
+void FPDB::setPragmas()
+{
+    //*** write ahead log - readers don't block the writer ***
+    execSql( "PRAGMA journal_mode = WAL" );
+
+    //*** with WAL, NORMAL only syncs at checkpoints ***
+    execSql( "PRAGMA synchronous = NORMAL" );
+
+    //*** 64 MB memory map, 8 MB page cache ***
+    execSql( "PRAGMA mmap_size = 67108864" );
+    execSql( "PRAGMA cache_size = -8192" );
+
+    execSql( "PRAGMA temp_store = MEMORY" );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::migrate
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::migrate()
+{
+QSqlQuery query(db_);
+int version = 0;
+
+    //*** sanity check ***
+    if ( !db_.isOpen() ) return false;
+
+    //*** get current schema version ***
+    if ( query.exec( "PRAGMA user_version" ) && query.next() )
+    {
+        version = query.value( 0 ).toInt();
+    }
+    query.finish();
+
+    //*** databases created before versioning have the table only ***
+    if ( version == 0 && db_.tables().contains( WeightTableName ) )
+    {
+        version = 1;
+    }
+
+    if ( version > SCHEMA_VERSION )
+    {
+        setError( QString( "Database schema version %1 is newer than supported (%2)" )
+                  .arg(version).arg(SCHEMA_VERSION) );
+        return false;
+    }
+
+    if ( version == SCHEMA_VERSION ) return true;
+
+    //*** apply all needed migrations as a unit ***
+    if ( !db_.transaction() )
+    {
+        setError( db_.lastError().text() );
+        return false;
+    }
+
+    for ( int v=version+1; v<=SCHEMA_VERSION; v++ )
+    {
+        if ( !applyMigration( v ) )
+        {
+            db_.rollback();
+            return false;
+        }
+    }
+
+    //*** record new version ***
+    if ( !execSql( QString( "PRAGMA user_version = %1" ).arg(SCHEMA_VERSION) ) )
+    {
+        db_.rollback();
+        return false;
+    }
+
+    if ( !db_.commit() )
+    {
+        setError( db_.lastError().text() );
+        db_.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::applyMigration
+ * @param version - version to migrate to
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::applyMigration( int version )
+{
+    switch ( version )
+    {
+    case 1:
+        return createDatabase();
+
+    case 2:
+        return execSql( QString( "create index if not exists %1 on %2 ( %3 )" )
+                        .arg(DateIndexName).arg(WeightTableName).arg(Date_Field) ) &&
+               execSql( QString( "create index if not exists %1 on %2 ( %3, %4 )" )
+                        .arg(FamDateIndexName).arg(WeightTableName).arg(Fam_ID_Field).arg(Date_Field) );
+
+    case 3:
+        //*** older rows have NULLs, which never clash in a unique index ***
+        return execSql( QString( "alter table %1 add column %2 integer" ).arg(WeightTableName).arg(Session_Field) ) &&
+               execSql( QString( "alter table %1 add column %2 integer" ).arg(WeightTableName).arg(Seq_Field) ) &&
+               execSql( QString( "create unique index if not exists %1 on %2 ( %3, %4 )" )
+                        .arg(DeliveryIndexName).arg(WeightTableName).arg(Session_Field).arg(Seq_Field) );
+
+    default:
+        setError( QString( "Unknown schema version %1" ).arg(version) );
+        return false;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::execSql
+ * @param sql
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::execSql( QString sql )
+{
+QSqlQuery query(db_);
+
+    if ( !query.exec( sql ) )
+    {
+        setError( query.lastError().text() );
         return false;
     }
 
@@ -195,6 +534,8 @@ bool rtn = true;
     QSqlError err = db_.lastError();
     rtn = !err.isValid();
 
+    if ( !rtn ) setError( err.text() );
+
     return rtn;
 }
 
@@ -207,13 +548,22 @@ bool rtn = true;
  * @param weight
  * @param date
  * @param name
+ * @param session
+ * @param seq
  * @return
  */
 //*****************************************************************************
-bool FPDB::addRecord( qint32 famId, float weight, qint64 date, QString name )
+bool FPDB::addRecord( qint32 famId, float weight, qint64 date, QString name, quint32 session, quint32 seq )
 {
 bool rtn = true;
 
+    //*** sanity check ***
+    if ( !insertQry_ )
+    {
+        setError( "Database is read only" );
+        return false;
+    }
+
     //*** ID for this record ***
     qint32 id = nextRecID_++;
 
@@ -224,12 +574,24 @@ bool rtn = true;
     insertQry_->bindValue( Date_Bind,   date );
     insertQry_->bindValue( Name_Bind,   name );
 
+    //*** NULL when not from a sequenced report ***
+    insertQry_->bindValue( Session_Bind, seq ? QVariant( session ) : QVariant( QVariant::UInt ) );
+    insertQry_->bindValue( Seq_Bind,     seq ? QVariant( seq ) : QVariant( QVariant::UInt ) );
+
     //*** execute the query ***
     if ( !insertQry_->exec() )
     {
-        lastError_ = insertQry_->lastError().text();
+        setError( insertQry_->lastError().text() );
         rtn = false;
     }
+    else
+    {
+        invalidateHistory( famId );
+
+        //*** a late weight for an archived day ***
+        WeightArchive *archive = archive_.loadAcquire();
+        if ( archive ) archive->markChanged( date );
+    }
 
     return rtn;
 }
@@ -238,41 +600,826 @@ bool rtn = true;
 //*****************************************************************************
 //*****************************************************************************
 /**
- * @brief FPDB::getTodaysStatistics
+ * @brief FPDB::addToDayTotal
+ * @param famId
+ * @param weight
+ * @param total
+ * @param day
  * @return
  */
 //*****************************************************************************
-QString FPDB::getTodaysStatistics()
+bool FPDB::addToDayTotal( qint32 famId, float weight, float total, qint64 day )
 {
-float totalWeight = 0;
-int   numEntries = 0;
-QString rtn;
+    //*** sanity check ***
+    if ( !isReady() ) return false;
 
-    //*** get todays date ***
-    qint64 date = QDate::currentDate().toJulianDay();
+    //*** no date field - a new row with the total, as before ***
+    if ( dayTotalField_.isEmpty() ) return addRecord( famId, total );
+
+    if ( !dayFindQry_ )
+    {
+        dayFindQry_ = new QSqlQuery( db_ );
+        dayFindQry_->setForwardOnly( true );
+        dayFindQry_->prepare( QString( "SELECT %1 FROM %2 WHERE %3 = %4 AND %5 >= :first AND %5 < :next ORDER BY %1" )
+                              .arg(ID_Field)
+                              .arg(WeightTableName)
+                              .arg(Fam_ID_Field)
+                              .arg(Fam_ID_Bind)
+                              .arg(dayTotalField_) );
+
+        dayUpdateQry_ = new QSqlQuery( db_ );
+        dayUpdateQry_->prepare( QString( "UPDATE %1 SET %2 = %2 + %3 WHERE %4 = %5" )
+                                .arg(WeightTableName)
+                                .arg(Weight_Field)
+                                .arg(Weight_Bind)
+                                .arg(ID_Field)
+                                .arg(ID_Bind) );
+
+        dayInsertQry_ = new QSqlQuery( db_ );
+        dayInsertQry_->prepare( QString( "INSERT INTO %1 ( %2, %3, %4 ) VALUES ( %5, %6, :when )" )
+                                .arg(WeightTableName)
+                                .arg(Fam_ID_Field)
+                                .arg(Weight_Field)
+                                .arg(dayTotalField_)
+                                .arg(Fam_ID_Bind)
+                                .arg(Weight_Bind) );
+    }
 
-    //*** set filter ***
-    weightTbl_->setFilter( QString("date = %1" ).arg(date) );
+    //*** the field is a date/time - match the whole local day, [midnight, next midnight). ***
+    //*** The insert below writes the report's day with the time now, so it falls inside. ***
+    QDate date = QDate::fromJulianDay( day );
+
+    dayFindQry_->bindValue( Fam_ID_Bind, famId );
+    dayFindQry_->bindValue( ":first", QDateTime( date, QTime( 0, 0 ) ) );
+    dayFindQry_->bindValue( ":next",  QDateTime( date.addDays( 1 ), QTime( 0, 0 ) ) );
+
+    if ( !dayFindQry_->exec() )
+    {
+        setError( dayFindQry_->lastError().text() );
+        return false;
+    }
 
-    //*** do the query ***
-    weightTbl_->select();
+    //*** the lowest key is the day's row - any others were not made here ***
+    QVariant key;
+    int rows = 0;
+    while ( dayFindQry_->next() )
+    {
+        if ( !rows++ ) key = dayFindQry_->value( 0 );
+    }
+    dayFindQry_->finish();
 
-    numEntries = weightTbl_->rowCount();
+    if ( rows > 1 )
+    {
+        qWarning() << "Family" << famId << "has" << rows << "rows for" << date.toString( Qt::ISODate )
+                   << "- adding to" << ID_Field << key.toString();
+    }
 
-    if ( numEntries > 0 )
+    if ( rows )
     {
-        //*** process all records ***
-        for ( int row=0; row<numEntries; row++ )
+        dayUpdateQry_->bindValue( Weight_Bind, weight );
+        dayUpdateQry_->bindValue( ID_Bind,     key );
+
+        if ( !dayUpdateQry_->exec() )
         {
-            totalWeight += weightTbl_->record( row ).value( Weight_Idx ).toFloat();
+            setError( dayUpdateQry_->lastError().text() );
+            return false;
         }
 
-        rtn.sprintf( "Count: %d   Weight %.1f lbs", numEntries, totalWeight );
+        return true;
+    }
+
+    //*** family's first weight of the day ***
+    dayInsertQry_->bindValue( Fam_ID_Bind, famId );
+    dayInsertQry_->bindValue( Weight_Bind, weight );
+    dayInsertQry_->bindValue( ":when",     QDateTime( date, QTime::currentTime() ) );
+
+    if ( !dayInsertQry_->exec() )
+    {
+        setError( dayInsertQry_->lastError().text() );
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getTodaysStatistics
+ * @return
+ */
+//*****************************************************************************
+QString FPDB::getTodaysStatistics()
+{
+QString rtn;
+
+    //*** sanity check ***
+    if ( !isReady() ) return lastError();
+
+    //*** get todays date ***
+    QDate today = QDate::currentDate();
+    qint64 date = today.toJulianDay();
+
+    t_WeightTotal total = getStatistics( date, date );
+
+    if ( total.count > 0 )
+    {
+        rtn.sprintf( "Count: %d   Weight %.1f lbs", total.count, total.weight );
     }
     else
     {
         rtn = "No entries today!!!";
     }
 
+    //*** to date - closed days come from the archive ***
+    t_WeightTotal week  = getStatistics( today.addDays( 1 - today.dayOfWeek() ).toJulianDay(), date );
+    t_WeightTotal month = getStatistics( QDate( today.year(), today.month(), 1 ).toJulianDay(), date );
+    t_WeightTotal year  = getStatistics( QDate( today.year(), 1, 1 ).toJulianDay(), date );
+
+    rtn += QString::asprintf( "\nWeek: %d / %.1f lbs   Month: %d / %.1f lbs   Year: %d / %.1f lbs",
+                              week.count, week.weight, month.count, month.weight, year.count, year.weight );
+
+    //*** families served ***
+    int weekFamilies  = getFamilyTotals( today.addDays( 1 - today.dayOfWeek() ).toJulianDay(), date ).size();
+    int monthFamilies = getFamilyTotals( QDate( today.year(), today.month(), 1 ).toJulianDay(), date ).size();
+
+    rtn += QString::asprintf( "\nFamilies - Week: %d   Month: %d", weekFamilies, monthFamilies );
+
     return rtn;
 }
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getStatistics
+ * @param firstDay
+ * @param lastDay
+ * @param famId
+ * @return
+ */
+//*****************************************************************************
+t_WeightTotal FPDB::getStatistics( qint64 firstDay, qint64 lastDay, qint32 famId )
+{
+t_WeightTotal total = { 0, 0.0 };
+t_WeightTotal archived = { 0, 0.0 };
+QSqlQuery query( readerDatabase() );
+WeightArchive *archive = archive_.loadAcquire();
+qint64 through = archive ? archive->archivedThrough() : -1;
+
+    //*** sanity check ***
+    if ( !isReady() ) return total;
+
+    //*** days the archive covers come from its index, the rest from the table ***
+    if ( firstDay <= through )
+    {
+        archived = archive->getTotal( firstDay, qMin( lastDay, through ), famId );
+        firstDay = through + 1;
+
+        if ( firstDay > lastDay ) return archived;
+    }
+
+    QString where = QString( "%1 between :first and :last" ).arg(Date_Field);
+    if ( famId != ALL_FAMILIES ) where += QString( " and %1 = %2" ).arg(Fam_ID_Field).arg(Fam_ID_Bind);
+
+    //*** aggregate for the range (uses the Date index) ***
+    query.setForwardOnly( true );
+    query.prepare( QString( "select count(*), sum(%1) from %2 where %3" )
+                   .arg(Weight_Field)
+                   .arg(WeightTableName)
+                   .arg(where) );
+    query.bindValue( ":first", firstDay );
+    query.bindValue( ":last",  lastDay );
+    if ( famId != ALL_FAMILIES ) query.bindValue( Fam_ID_Bind, famId );
+
+    if ( !query.exec() || !query.next() )
+    {
+        setError( query.lastError().text() );
+        return total;
+    }
+
+    total.count  = query.value( 0 ).toInt()    + archived.count;
+    total.weight = query.value( 1 ).toDouble() + archived.weight;
+
+    return total;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getFamilyTotals
+ * @param firstDay
+ * @param lastDay
+ * @return
+ */
+//*****************************************************************************
+QMap<qint32,t_WeightTotal> FPDB::getFamilyTotals( qint64 firstDay, qint64 lastDay )
+{
+QMap<qint32,t_WeightTotal> totals;
+QSqlQuery query( readerDatabase() );
+WeightArchive *archive = archive_.loadAcquire();
+qint64 through = archive ? archive->archivedThrough() : -1;
+
+    //*** sanity check ***
+    if ( !isReady() ) return totals;
+
+    //*** days the archive covers come from its blocks, the rest from the table ***
+    if ( firstDay <= through )
+    {
+        totals   = archive->getFamilyTotals( firstDay, qMin( lastDay, through ) );
+        firstDay = through + 1;
+
+        if ( firstDay > lastDay ) return totals;
+    }
+
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, count(*), sum(%2) from %3 where %4 between :first and :last group by %1" )
+                   .arg(Fam_ID_Field)
+                   .arg(Weight_Field)
+                   .arg(WeightTableName)
+                   .arg(Date_Field) );
+    query.bindValue( ":first", firstDay );
+    query.bindValue( ":last",  lastDay );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return totals;
+    }
+
+    while ( query.next() )
+    {
+        t_WeightTotal &total = totals[query.value( 0 ).toInt()];
+        total.count  += query.value( 1 ).toInt();
+        total.weight += query.value( 2 ).toDouble();
+    }
+
+    return totals;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getTodaysStatisticsAsync
+ * @return
+ */
+//*****************************************************************************
+QFuture<QString> FPDB::getTodaysStatisticsAsync()
+{
+    return QtConcurrent::run( &readPool_, [=]() { return getTodaysStatistics(); } );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getStatisticsAsync
+ * @param firstDay
+ * @param lastDay
+ * @return
+ */
+//*****************************************************************************
+QFuture<t_WeightTotal> FPDB::getStatisticsAsync( qint64 firstDay, qint64 lastDay )
+{
+    return QtConcurrent::run( &readPool_, [=]() { return getStatistics( firstDay, lastDay ); } );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getDayTotals
+ * @param beforeDay
+ * @return
+ */
+//*****************************************************************************
+QVector<t_DayTotal> FPDB::getDayTotals( qint64 beforeDay )
+{
+QVector<t_DayTotal> days;
+QSqlQuery query( readerDatabase() );
+t_DayTotal day;
+
+    //*** sanity check ***
+    if ( !isReady() ) return days;
+
+    //*** grouped on the Date index, the archive compares these to what it holds ***
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, count(*), sum(%2) from %3 where %1 < %4 group by %1 order by %1" )
+                   .arg(Date_Field)
+                   .arg(Weight_Field)
+                   .arg(WeightTableName)
+                   .arg(Date_Bind) );
+    query.bindValue( Date_Bind, beforeDay );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return days;
+    }
+
+    while ( query.next() )
+    {
+        day.day    = query.value( 0 ).toLongLong();
+        day.count  = query.value( 1 ).toInt();
+        day.weight = query.value( 2 ).toDouble();
+        days.append( day );
+    }
+
+    return days;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getDayRecords
+ * @param day
+ * @param recs
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::getDayRecords( qint64 day, QVector<t_WeightRec> &recs )
+{
+QSqlQuery query( readerDatabase() );
+t_WeightRec rec;
+
+    recs.clear();
+
+    //*** sanity check ***
+    if ( !isReady() ) return false;
+
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, %2, %3 from %4 where %5 = %6 order by %1" )
+                   .arg(ID_Field)
+                   .arg(Fam_ID_Field)
+                   .arg(Weight_Field)
+                   .arg(WeightTableName)
+                   .arg(Date_Field)
+                   .arg(Date_Bind) );
+    query.bindValue( Date_Bind, day );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return false;
+    }
+
+    rec.date = day;
+
+    while ( query.next() )
+    {
+        rec.recId  = query.value( 0 ).toInt();
+        rec.famId  = query.value( 1 ).toInt();
+        rec.weight = query.value( 2 ).toFloat();
+        recs.append( rec );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getLastSeq
+ * @param session
+ * @return
+ */
+//*****************************************************************************
+qint64 FPDB::getLastSeq( quint32 session )
+{
+QSqlQuery query( readerDatabase() );
+
+    //*** sanity check ***
+    if ( !isReady() || !isLocal_ ) return -1;
+
+    query.setForwardOnly( true );
+    query.prepare( QString( "select max(%1) from %2 where %3 = %4" )
+                   .arg(Seq_Field)
+                   .arg(WeightTableName)
+                   .arg(Session_Field)
+                   .arg(Session_Bind) );
+    query.bindValue( Session_Bind, session );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return -1;
+    }
+
+    return query.next() ? query.value( 0 ).toLongLong() : 0;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getFamilyHistory
+ * @param famId
+ * @param maxVisits
+ * @param history
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::getFamilyHistory( qint32 famId, int maxVisits, t_FamilyHistory &history )
+{
+quint32 gen;
+bool cached = false;
+
+    //*** sanity check ***
+    if ( !isReady() || !isLocal_ ) return false;
+
+    {
+        QMutexLocker lock( &historyMutex_ );
+
+        //*** a copy - the vectors are shared, so this is cheap ***
+        t_FamilyHistory *entry = historyCache_.object( famId );
+        if ( entry )
+        {
+            history = *entry;
+            cached  = true;
+        }
+
+        gen = historyGen_;
+    }
+
+    if ( !cached )
+    {
+        if ( !queryFamilyHistory( famId, history ) ) return false;
+
+        QMutexLocker lock( &historyMutex_ );
+
+        //*** a record was added while reading - don't keep what may be stale ***
+        if ( gen == historyGen_ )
+        {
+            historyCache_.insert( famId, new t_FamilyHistory( history ) );
+        }
+    }
+
+    if ( maxVisits > 0 && history.visits.size() > maxVisits )
+    {
+        history.visits.resize( maxVisits );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getFamilyHistoryAsync
+ * @param famId
+ * @param maxVisits
+ * @return
+ */
+//*****************************************************************************
+QFuture<t_FamilyHistory> FPDB::getFamilyHistoryAsync( qint32 famId, int maxVisits )
+{
+    return QtConcurrent::run( &readPool_, [=]()
+    {
+        t_FamilyHistory history;
+        history.total = { 0, 0.0 };
+
+        //*** ALL_FAMILIES if the read failed ***
+        if ( !getFamilyHistory( famId, maxVisits, history ) ) history.famId = ALL_FAMILIES;
+
+        return history;
+    } );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::queryFamilyHistory
+ * @param famId
+ * @param history
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::queryFamilyHistory( qint32 famId, t_FamilyHistory &history )
+{
+QSqlQuery query( readerDatabase() );
+WeightArchive *archive = archive_.loadAcquire();
+qint64 through = archive ? archive->archivedThrough() : -1;
+t_DayTotal visit;
+int y, m, d;
+
+    history.famId = famId;
+    history.visits.clear();
+    history.months.clear();
+    history.total = { 0, 0.0 };
+
+    //*** one row per visit since the archive (uses the Fam_Id, Date index) ***
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, count(*), sum(%2) from %3 where %4 = %5 and %1 > :through group by %1 order by %1 desc" )
+                   .arg(Date_Field)
+                   .arg(Weight_Field)
+                   .arg(WeightTableName)
+                   .arg(Fam_ID_Field)
+                   .arg(Fam_ID_Bind) );
+    query.bindValue( Fam_ID_Bind, famId );
+    query.bindValue( ":through",  through );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return false;
+    }
+
+    while ( query.next() )
+    {
+        visit.day    = query.value( 0 ).toLongLong();
+        visit.count  = query.value( 1 ).toInt();
+        visit.weight = query.value( 2 ).toDouble();
+        history.visits.append( visit );
+    }
+
+    //*** older visits from the archive, which has every day up to 'through' ***
+    if ( through >= 0 )
+    {
+        history.visits += archive->getFamilyDays( famId, 0, through );
+    }
+
+    for ( int i=0; i<history.visits.size(); i++ )
+    {
+        visit = history.visits[i];
+
+        history.total.count  += visit.count;
+        history.total.weight += visit.weight;
+
+        //*** roll up into the visit's month ***
+        QDate::fromJulianDay( visit.day ).getDate( &y, &m, &d );
+        visit.day = QDate( y, m, 1 ).toJulianDay();
+
+        if ( !history.months.isEmpty() && history.months.last().day == visit.day )
+        {
+            history.months.last().count  += visit.count;
+            history.months.last().weight += visit.weight;
+        }
+        else if ( history.months.size() < HISTORY_MONTHS )
+        {
+            history.months.append( visit );
+        }
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::invalidateHistory
+ * @param famId
+ */
+//*****************************************************************************
+void FPDB::invalidateHistory( qint32 famId )
+{
+    QMutexLocker lock( &historyMutex_ );
+
+    historyCache_.remove( famId );
+    historyGen_++;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getRecordedNames
+ * @param names
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::getRecordedNames( QVector<t_FamilyName> &names )
+{
+QSqlQuery query( readerDatabase() );
+t_FamilyName fam;
+
+    names.clear();
+
+    //*** sanity check ***
+    if ( !isReady() || !isLocal_ ) return false;
+
+    //*** name from each family's latest named record ***
+    query.setForwardOnly( true );
+    if ( !query.exec( QString( "select %1, %2 from %3 where %4 in "
+                               "( select max(%4) from %3 where %2 <> '' group by %1 )" )
+                      .arg(Fam_ID_Field)
+                      .arg(Name_Field)
+                      .arg(WeightTableName)
+                      .arg(ID_Field) ) )
+    {
+        setError( query.lastError().text() );
+        return false;
+    }
+
+    while ( query.next() )
+    {
+        fam.key  = query.value( 0 ).toInt();
+        fam.name = query.value( 1 ).toString();
+        names.append( fam );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::getFamilyNames
+ * @param table
+ * @param keyField
+ * @param nameField
+ * @param afterKey
+ * @param names
+ * @return
+ */
+//*****************************************************************************
+bool FPDB::getFamilyNames( QString table, QString keyField, QString nameField, qint32 afterKey,
+                           QVector<t_FamilyName> &names )
+{
+QSqlQuery query( readerDatabase() );
+t_FamilyName fam;
+
+    names.clear();
+
+    //*** sanity check ***
+    if ( !isReady() ) return false;
+
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, %2 from %3 where %1 > ?" )
+                   .arg(keyField)
+                   .arg(nameField)
+                   .arg(table) );
+    query.addBindValue( afterKey );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return false;
+    }
+
+    while ( query.next() )
+    {
+        fam.key  = query.value( 0 ).toInt();
+        fam.name = query.value( 1 ).toString().trimmed();
+        names.append( fam );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FPDB::exportRecords - forward only, so memory use does not grow
+ *        with the number of rows
+ * @param out
+ * @param format
+ * @param firstDay
+ * @param lastDay
+ * @param famId
+ * @return
+ */
+//*****************************************************************************
+qint64 FPDB::exportRecords( QIODevice *out, ExportFormat format, qint64 firstDay, qint64 lastDay, qint32 famId )
+{
+QSqlQuery query( readerDatabase() );
+QString where = QString( "%1 between ? and ?" ).arg(Date_Field);
+char buf[EXPORT_BUFFER_SIZE];
+char line[256];
+int used = 0;
+qint64 rows = 0;
+int y, m, d;
+
+    //*** sanity check ***
+    if ( !isReady() ) return -1;
+
+    if ( famId != ALL_FAMILIES ) where += QString( " and %1 = ?" ).arg(Fam_ID_Field);
+
+    query.setForwardOnly( true );
+    query.prepare( QString( "select %1, %2, %3, %4, %5 from %6 where %7 order by %1" )
+                   .arg(ID_Field)
+                   .arg(Fam_ID_Field)
+                   .arg(Weight_Field)
+                   .arg(Date_Field)
+                   .arg(Name_Field)
+                   .arg(WeightTableName)
+                   .arg(where) );
+    query.addBindValue( firstDay );
+    query.addBindValue( lastDay );
+    if ( famId != ALL_FAMILIES ) query.addBindValue( famId );
+
+    if ( !query.exec() )
+    {
+        setError( query.lastError().text() );
+        return -1;
+    }
+
+    //*** appends to the buffer, writing it out when full ***
+    auto put = [&]( const char *data, int len ) -> bool
+    {
+        if ( used + len > EXPORT_BUFFER_SIZE )
+        {
+            if ( out->write( buf, used ) != used ) return false;
+            used = 0;
+        }
+
+        memcpy( buf + used, data, len );
+        used += len;
+        return true;
+    };
+
+    if ( format == EXPORT_CSV )
+    {
+        int len = snprintf( line, sizeof(line), "%s,%s,%s,%s,%s\n",
+                            qPrintable(ID_Field), qPrintable(Fam_ID_Field), qPrintable(Weight_Field),
+                            qPrintable(Date_Field), qPrintable(Name_Field) );
+        put( line, len );
+    }
+
+    while ( query.next() )
+    {
+        QDate::fromJulianDay( query.value( 3 ).toLongLong() ).getDate( &y, &m, &d );
+
+        QByteArray name = query.value( 4 ).toString().toUtf8();
+        bool ok;
+
+        if ( format == EXPORT_CSV )
+        {
+            int len = snprintf( line, sizeof(line), "%d,%d,%.2f,%04d-%02d-%02d,\"",
+                                query.value( 0 ).toInt(), query.value( 1 ).toInt(),
+                                query.value( 2 ).toDouble(), y, m, d );
+            ok = put( line, len );
+
+            //*** quotes doubled ***
+            for ( int i = 0; ok && i < name.size(); i++ )
+            {
+                ok = ( name[i] == '"' ) ? put( "\"\"", 2 ) : put( name.constData() + i, 1 );
+            }
+
+            ok = ok && put( "\"\n", 2 );
+        }
+        else
+        {
+            int len = snprintf( line, sizeof(line), "{\"recId\":%d,\"famId\":%d,\"weight\":%.2f,\"date\":\"%04d-%02d-%02d\",\"name\":\"",
+                                query.value( 0 ).toInt(), query.value( 1 ).toInt(),
+                                query.value( 2 ).toDouble(), y, m, d );
+            ok = put( line, len );
+
+            //*** JSON string escapes ***
+            for ( int i = 0; ok && i < name.size(); i++ )
+            {
+                unsigned char c = name[i];
+
+                if ( c == '"' || c == '\\' )
+                {
+                    char esc[2] = { '\\', (char)c };
+                    ok = put( esc, 2 );
+                }
+                else if ( c < 0x20 )
+                {
+                    len = snprintf( line, sizeof(line), "\\u%04x", c );
+                    ok = put( line, len );
+                }
+                else
+                {
+                    ok = put( name.constData() + i, 1 );
+                }
+            }
+
+            ok = ok && put( "\"}\n", 3 );
+        }
+
+        if ( !ok )
+        {
+            setError( out->errorString() );
+            return -1;
+        }
+
+        rows++;
+    }
+
+    //*** next() is also FALSE when the read fails part way ***
+    if ( query.lastError().isValid() )
+    {
+        setError( query.lastError().text() );
+        return -1;
+    }
+
+    //*** what is left in the buffer ***
+    if ( used && out->write( buf, used ) != used )
+    {
+        setError( out->errorString() );
+        return -1;
+    }
+
+    return rows;
+}
@@ -4,8 +4,18 @@
 #include <QObject>
 #include <QSql>
 #include <QSqlDatabase>
-#include <QSqlTableModel>
 #include <QSqlQuery>
+#include <QVector>
+#include <QMap>
+#include <QMutex>
+#include <QCache>
+#include <QThreadPool>
+#include <QFuture>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+class QIODevice;
+class WeightArchive;
 
 
 //**********************************************************
@@ -13,6 +23,40 @@
 //**********************************************************
 const QString WeightTableName   = "tbl_Weight";
 
+//**********************************************************
+//********************* Index Names ************************
+//**********************************************************
+const QString DateIndexName     = "idx_Weight_Date";
+const QString FamDateIndexName  = "idx_Weight_FamId_Date";
+const QString DeliveryIndexName = "idx_Weight_Session_Seq";
+
+//**********************************************************
+//******************** Schema Version **********************
+//**********************************************************
+//*** 1 - weights table                                  ***
+//*** 2 - indexes on Date and (Fam_Id, Date)             ***
+//*** 3 - Session, Seq of the scale report (unique)      ***
+//**********************************************************
+const int SCHEMA_VERSION = 3;
+
+//*** number of read only (reporting) connections ***
+const int READER_POOL_SIZE = 2;
+
+//*** use to query all families ***
+const qint32 ALL_FAMILIES = -1;
+
+//*** family histories kept in memory (least recently used are dropped) ***
+const int HISTORY_CACHE_SIZE = 256;
+
+//*** monthly totals in a family history ***
+const int HISTORY_MONTHS = 12;
+
+//*** export output ***
+enum ExportFormat { EXPORT_CSV, EXPORT_JSON };
+
+//*** export is written through a buffer of this size ***
+const int EXPORT_BUFFER_SIZE = 64 * 1024;
+
 //**********************************************************
 //********************* Field Names ************************
 //**********************************************************
@@ -21,6 +65,8 @@ const QString Fam_ID_Field = "Fam_Id";
 const QString Weight_Field = "Weight";
 const QString Date_Field   = "Date";
 const QString Name_Field   = "Name";
+const QString Session_Field = "Session";
+const QString Seq_Field     = "Seq";
 
 
 //**********************************************************
@@ -31,6 +77,8 @@ const QString Fam_ID_Bind = ":" + Fam_ID_Field;
 const QString Weight_Bind = ":" + Weight_Field;
 const QString Date_Bind   = ":" + Date_Field;
 const QString Name_Bind   = ":" + Name_Field;
+const QString Session_Bind = ":" + Session_Field;
+const QString Seq_Bind     = ":" + Seq_Field;
 
 //***********************************************************
 //********************* Column Names ************************
@@ -42,6 +90,45 @@ const int Date_Idx   = 3;
 const int Name_Idx   = 4;
 
 
+//***********************************************************
+//********************* Record Types ************************
+//***********************************************************
+typedef struct
+{
+    qint32 recId;
+    qint32 famId;
+    float  weight;
+    qint64 date;
+} t_WeightRec;
+
+typedef struct
+{
+    int    count;
+    double weight;
+} t_WeightTotal;
+
+typedef struct
+{
+    qint32  key;
+    QString name;
+} t_FamilyName;
+
+typedef struct
+{
+    qint64 day;             // julian, first of the month for monthly totals
+    int    count;
+    double weight;
+} t_DayTotal;
+
+typedef struct
+{
+    qint32              famId;
+    QVector<t_DayTotal> visits;     // most recent first
+    QVector<t_DayTotal> months;     // most recent first, up to HISTORY_MONTHS
+    t_WeightTotal       total;      // every visit
+} t_FamilyHistory;
+
+
 //*****************************************************************************
 //*****************************************************************************
 /**
@@ -54,25 +141,91 @@ class FPDB : public QObject
 
 public:
 
-    //*** constructor ***
-    explicit FPDB( QString driver, QString dsn, QString label, bool isLocal, QObject *parent = nullptr);
+    //*** constructor - read only opens an existing local database as is (no migration, ***
+    //*** no pragmas, nothing can be added)                                               ***
+    explicit FPDB( QString driver, QString dsn, QString label, bool isLocal, bool readOnly = false,
+                   QObject *parent = nullptr);
 
     //*** destructor ***
     ~FPDB();
 
-    //*** if TRUE, database is opened and ready ***
-    bool isReady() { return isReady_; }
+    //*** if TRUE, database is opened and ready (any thread) ***
+    bool isReady() { return ready_.loadAcquire() != 0; }
 
     //*** returns string describing the last error ***
-    QString lastError() { return lastError_; }
+    QString lastError() { QMutexLocker lock( &errorMutex_ ); return lastError_; }
+
+    //*** drops the writer connection and opens it again - reader connections ***
+    //*** are replaced by their threads on next use                          ***
+    bool reopen();
+
+    //*** cheap query on the writer connection, FALSE (and not ready) if it fails ***
+    bool probe();
 
     //*** adds a record ***
     bool addRecord( qint32 famId, float weight );
-    bool addRecord( qint32 famId, float weight, qint64 date, QString name );
 
-    //*** gets a string with the statistics for the day ***
+    //*** Access - date/time field that makes addToDayTotal() an upsert, empty - a row per call ***
+    void setDayTotalField( QString field ) { dayTotalField_ = field; }
+
+    //*** Access - adds weight to the family's row for the day, inserting it if there is none. ***
+    //*** Without a day total field a new row with the visit's running total is inserted.      ***
+    bool addToDayTotal( qint32 famId, float weight, float total, qint64 day );
+
+    //*** local - a record with a session/seq already stored is skipped (seq 0 = none) ***
+    bool addRecord( qint32 famId, float weight, qint64 date, QString name,
+                    quint32 session = 0, quint32 seq = 0 );
+
+    //*************************************************************
+    //*** read functions use a read only connection per thread, ***
+    //*** so they never contend with inserts on the writer      ***
+    //*************************************************************
+
+    //*** gets a string with the statistics for the day, week, month and year ***
     QString getTodaysStatistics();
 
+    //*** count and total weight for an inclusive range of days (archived days from the archive) ***
+    t_WeightTotal getStatistics( qint64 firstDay, qint64 lastDay, qint32 famId = ALL_FAMILIES );
+
+    //*** count and total weight of each family with records in an inclusive range of days ***
+    QMap<qint32,t_WeightTotal> getFamilyTotals( qint64 firstDay, qint64 lastDay );
+
+    //*** local - archive of closed days used by the statistics and histories, NULL for none ***
+    void setArchive( WeightArchive *archive ) { archive_.storeRelease( archive ); }
+
+    //*** as above, run on the reader pool ***
+    QFuture<QString>       getTodaysStatisticsAsync();
+    QFuture<t_WeightTotal> getStatisticsAsync( qint64 firstDay, qint64 lastDay );
+
+    //*** pool that runs the async reads ***
+    QThreadPool *readPool() { return &readPool_; }
+
+    //*** count and total weight of each day (julian) with records, before 'beforeDay' ***
+    QVector<t_DayTotal> getDayTotals( qint64 beforeDay );
+
+    //*** gets all records for a day, in record ID order ***
+    bool getDayRecords( qint64 day, QVector<t_WeightRec> &recs );
+
+    //*** highest scale report seq stored for a session (0 if none, -1 on error) ***
+    qint64 getLastSeq( quint32 session );
+
+    //*** a family's last 'maxVisits' visits (0 = all) and totals, served from memory when cached (local) ***
+    bool getFamilyHistory( qint32 famId, int maxVisits, t_FamilyHistory &history );
+
+    //*** as above, run on the reader pool ***
+    QFuture<t_FamilyHistory> getFamilyHistoryAsync( qint32 famId, int maxVisits );
+
+    //*** latest name recorded for each family (local) ***
+    bool getRecordedNames( QVector<t_FamilyName> &names );
+
+    //*** streams records for an inclusive range of days to 'out', returns rows or -1 ***
+    qint64 exportRecords( QIODevice *out, ExportFormat format, qint64 firstDay, qint64 lastDay,
+                          qint32 famId = ALL_FAMILIES );
+
+    //*** families from a roster table, IDs above 'afterKey' only ***
+    bool getFamilyNames( QString table, QString keyField, QString nameField, qint32 afterKey,
+                         QVector<t_FamilyName> &names );
+
 
 private:
 
@@ -82,8 +235,35 @@ private:
     //*** create the database tables ***
     bool createDatabase();
 
+    //*** read only connection for the calling thread ***
+    QSqlDatabase readerDatabase();
+
+    //*** saves the last error (thread safe) ***
+    void setError( QString error );
+
+    //*** sets connection pragmas (local only) ***
+    void setPragmas();
+
+    //*** brings the local schema up to SCHEMA_VERSION ***
+    bool migrate();
+
+    //*** applies a single schema migration ***
+    bool applyMigration( int version );
+
+    //*** executes a statement, saving any error ***
+    bool execSql( QString sql );
+
+    //*** reads a family's full history (reader connection) ***
+    bool queryFamilyHistory( qint32 famId, t_FamilyHistory &history );
+
+    //*** drops a family's cached history (it has a new record) ***
+    void invalidateHistory( qint32 famId );
+
     bool isLocal_;
-    bool isReady_;
+    bool readOnly_;
+
+    //*** set on the sink thread, read everywhere ***
+    QAtomicInt ready_;
 
     //*** driver and DSN for database ***
     QString driver_;
@@ -92,18 +272,37 @@ private:
 
     //*** last SQL error ***
     QString lastError_;
+    QMutex  errorMutex_;
 
-    //*** database ***
+    //*** database (writer) ***
     QSqlDatabase db_;
 
-    //*** 'Weight' table model ***
-    QSqlTableModel *weightTbl_;
+    //*** reader threads and their connection names, generation bumps on reopen ***
+    QThreadPool readPool_;
+    QMutex      readerMutex_;
+    QStringList readerNames_;
+    QAtomicInt  readerGen_;
 
     //*** 'prepared' insert query
     QSqlQuery *insertQry_;
 
+    //*** day total upsert (Access), prepared on first use ***
+    QString    dayTotalField_;
+    QSqlQuery *dayFindQry_;
+    QSqlQuery *dayUpdateQry_;
+    QSqlQuery *dayInsertQry_;
+
     //*** next unique record ID ***
     int nextRecID_;
+
+    //*** closed days, told about late records ***
+    QAtomicPointer<WeightArchive> archive_;
+
+    //*** family histories by ID - generation bumps on every invalidate, so ***
+    //*** a read that raced a new record is not cached (historyMutex_)      ***
+    QMutex                          historyMutex_;
+    QCache<qint32,t_FamilyHistory>  historyCache_;
+    quint32                         historyGen_;
 };
 
 #endif // FPDB_H
@@ -0,0 +1,186 @@
+#include "FamilyRoster.h"
+
+#include <algorithm>
+
+
+//*** overlay entries before they are folded into the arrays ***
+const int MAX_OVERLAY = 256;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::FamilyRoster
+ */
+//*****************************************************************************
+FamilyRoster::FamilyRoster()
+{
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::find
+ * @param key
+ * @return
+ */
+//*****************************************************************************
+int FamilyRoster::find( qint32 key ) const
+{
+    QVector<qint32>::const_iterator it = std::lower_bound( keys_.constBegin(), keys_.constEnd(), key );
+
+    if ( it == keys_.constEnd() || *it != key ) return -1;
+
+    return it - keys_.constBegin();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::name
+ * @param key
+ * @return
+ */
+//*****************************************************************************
+QString FamilyRoster::name( qint32 key ) const
+{
+    QHash<qint32,QString>::const_iterator it = overlay_.constFind( key );
+    if ( it != overlay_.constEnd() ) return it.value();
+
+    int idx = find( key );
+
+    return ( idx < 0 ) ? QString() : names_.at( idx );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::contains
+ * @param key
+ * @return
+ */
+//*****************************************************************************
+bool FamilyRoster::contains( qint32 key ) const
+{
+    return overlay_.contains( key ) || find( key ) >= 0;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::insert
+ * @param key
+ * @param name
+ */
+//*****************************************************************************
+void FamilyRoster::insert( qint32 key, QString name )
+{
+    int idx = find( key );
+
+    //*** already in the arrays - rename in place ***
+    if ( idx >= 0 )
+    {
+        names_[idx] = name;
+        overlay_.remove( key );
+        return;
+    }
+
+    overlay_[key] = name;
+
+    if ( overlay_.size() > MAX_OVERLAY ) compact();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::merge
+ * @param names
+ */
+//*****************************************************************************
+void FamilyRoster::merge( const QVector<t_FamilyName> &names )
+{
+QVector<t_FamilyName> batch = names;
+QVector<qint32>  keys;
+QVector<QString> vals;
+
+    if ( batch.isEmpty() ) return;
+
+    //*** stable - the last of any repeated ID wins ***
+    std::stable_sort( batch.begin(), batch.end(),
+                      []( const t_FamilyName &a, const t_FamilyName &b ) { return a.key < b.key; } );
+
+    keys.reserve( keys_.size() + batch.size() );
+    vals.reserve( keys_.size() + batch.size() );
+
+    //*** merge two sorted lists, the batch wins ties ***
+    int i = 0, j = 0;
+
+    while ( i < keys_.size() || j < batch.size() )
+    {
+        qint32  key;
+        QString val;
+
+        if ( j >= batch.size() || ( i < keys_.size() && keys_[i] < batch[j].key ) )
+        {
+            key = keys_[i];
+            val = names_[i];
+            i++;
+        }
+        else
+        {
+            key = batch[j].key;
+            val = batch[j].name;
+            if ( i < keys_.size() && keys_[i] == key ) i++;
+            j++;
+        }
+
+        //*** repeated ID in the batch - replace ***
+        if ( !keys.isEmpty() && keys.last() == key )
+        {
+            vals.last() = val;
+        }
+        else
+        {
+            keys.append( key );
+            vals.append( val );
+        }
+    }
+
+    keys_.swap( keys );
+    names_.swap( vals );
+
+    //*** overlay entries now in the arrays no longer count twice ***
+    compact();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FamilyRoster::compact
+ */
+//*****************************************************************************
+void FamilyRoster::compact()
+{
+QVector<t_FamilyName> pending;
+t_FamilyName fam;
+
+    if ( overlay_.isEmpty() ) return;
+
+    for ( QHash<qint32,QString>::const_iterator it = overlay_.constBegin(); it != overlay_.constEnd(); ++it )
+    {
+        fam.key  = it.key();
+        fam.name = it.value();
+        pending.append( fam );
+    }
+
+    //*** clear first - merge() calls compact() ***
+    overlay_.clear();
+
+    merge( pending );
+}
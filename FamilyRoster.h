@@ -0,0 +1,60 @@
+#ifndef FAMILYROSTER_H
+#define FAMILYROSTER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#include "FPDB.h"
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The FamilyRoster class
+ *
+ * Family ID to name, all in memory. Bulk loads go into arrays sorted by ID
+ * (IDs packed together for the binary search); names from check-ins go into
+ * a small overlay that wins over the arrays and is folded in once it grows.
+ * Unknown IDs return a null string - nothing is inserted by a lookup.
+ */
+//*****************************************************************************
+class FamilyRoster
+{
+public:
+
+    //*** constructor ***
+    FamilyRoster();
+
+    //*** name for a family, null if unknown ***
+    QString name( qint32 key ) const;
+
+    //*** if TRUE, family is known ***
+    bool contains( qint32 key ) const;
+
+    //*** adds or renames one family (check-in) ***
+    void insert( qint32 key, QString name );
+
+    //*** adds or renames a batch of families (roster load / refresh) ***
+    void merge( const QVector<t_FamilyName> &names );
+
+    //*** number of families ***
+    int size() const { return keys_.size() + overlay_.size(); }
+
+private:
+
+    //*** index of key in keys_, -1 if not there ***
+    int find( qint32 key ) const;
+
+    //*** folds the overlay into the sorted arrays ***
+    void compact();
+
+    //*** sorted by key, names_[i] belongs to keys_[i] ***
+    QVector<qint32>  keys_;
+    QVector<QString> names_;
+
+    //*** recent changes ***
+    QHash<qint32,QString> overlay_;
+};
+
+#endif // FAMILYROSTER_H
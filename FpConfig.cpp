@@ -0,0 +1,270 @@
+#include "FpConfig.h"
+
+#include <QSettings>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+
+//*****************
+//*** CONSTANTS ***
+//*****************
+const QString CONFIG_FILE_NAME = "fpSvr.ini";
+
+//*** command line options ***
+const QString OPT_CONFIG = "config";
+const QString OPT_SET    = "set";
+
+
+#ifdef Q_OS_UNIX
+//*** socket pair used to get SIGHUP into the event loop ***
+static int sigHupFd_[2] = { -1, -1 };
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief sigHupHandler - only async signal safe calls allowed here
+ */
+//*****************************************************************************
+static void sigHupHandler( int )
+{
+char a = 1;
+
+    if ( ::write( sigHupFd_[0], &a, sizeof(a) ) < 0 ) return;
+}
+#endif
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief dataDir - default location of the databases
+ */
+//*****************************************************************************
+static QString dataDir()
+{
+#ifdef Q_OS_WIN
+    return "c:/fp";
+#else
+    return QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::FpConfig
+ * @param parent
+ */
+//*****************************************************************************
+FpConfig::FpConfig( QObject *parent ) : QObject(parent)
+{
+    sigHupNotifier_ = Q_NULLPTR;
+
+#ifdef Q_OS_WIN
+    fileName_ = dataDir() + "/" + CONFIG_FILE_NAME;
+#else
+    fileName_ = QStandardPaths::writableLocation( QStandardPaths::AppConfigLocation ) + "/" + CONFIG_FILE_NAME;
+#endif
+
+    setDefaults();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::~FpConfig
+ */
+//*****************************************************************************
+FpConfig::~FpConfig()
+{
+#ifdef Q_OS_UNIX
+    if ( sigHupNotifier_ )
+    {
+        signal( SIGHUP, SIG_DFL );
+        ::close( sigHupFd_[0] );
+        ::close( sigHupFd_[1] );
+    }
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::setDefaults
+ */
+//*****************************************************************************
+void FpConfig::setDefaults()
+{
+    values_.clear();
+
+    values_[CFG_SCALE_ADDR]         = "10.0.1.1";
+    values_[CFG_SCALE_PORT]         = 29456;
+    values_[CFG_CONNECT_TIMEOUT_MS] = 1000;
+
+    values_[CFG_CHECKIN_PORT]       = 29457;
+    values_[CFG_CHECKIN_SOCKET]     = "";
+
+    values_[CFG_RECV_BUFFER_SIZE]   = 0;
+    values_[CFG_SEND_BUFFER_SIZE]   = 0;
+
+    values_[CFG_ACCESS_DSN]         = "FP_WEIGHTS";
+    values_[CFG_ACCESS_DATE_FIELD]  = "";
+    values_[CFG_ACCESS_DEBOUNCE_MS] = 2000;
+    values_[CFG_LOCAL_DB_PATH]      = dataDir() + "/fp.db";
+    values_[CFG_ARCHIVE_PATH]       = dataDir() + "/archive";
+    values_[CFG_ARCHIVE_CHECK_MS]   = 60 * 60 * 1000;
+    values_[CFG_JOURNAL_PATH]       = "";
+    values_[CFG_SINK_QUEUE_DEPTH]   = 1000;
+    values_[CFG_SINK_PROBE_MS]      = 30 * 1000;
+    values_[CFG_DEAD_LETTER_DIR]    = dataDir();
+
+    values_[CFG_EVENT_LOG_PATH]     = dataDir() + "/events.fplog";
+    values_[CFG_EVENT_LOG_MAX_BYTES] = 16 * 1024 * 1024;
+    values_[CFG_EVENT_LOG_KEEP]     = 5;
+
+    values_[CFG_ROSTER_TABLE]       = "";
+    values_[CFG_ROSTER_KEY_FIELD]   = "Fam_Id";
+    values_[CFG_ROSTER_NAME_FIELD]  = "Name";
+    values_[CFG_ROSTER_REFRESH_MS]  = 5 * 60 * 1000;
+
+    values_[CFG_LIVE_GROUP]         = "239.255.41.1";
+    values_[CFG_LIVE_PORT]          = 29458;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::addOptions
+ * @param parser
+ */
+//*****************************************************************************
+void FpConfig::addOptions( QCommandLineParser &parser )
+{
+    parser.addOption( QCommandLineOption( QStringList() << "c" << OPT_CONFIG,
+                                          "Config file (default " + fileName_ + ").", "file" ) );
+    parser.addOption( QCommandLineOption( QStringList() << "s" << OPT_SET,
+                                          "Override a config setting, e.g. scale/port=29456.", "key=value" ) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::parse
+ * @param parser
+ */
+//*****************************************************************************
+void FpConfig::parse( const QCommandLineParser &parser )
+{
+    if ( parser.isSet( OPT_CONFIG ) )
+    {
+        fileName_ = parser.value( OPT_CONFIG );
+    }
+
+    //*** save overrides, they win over the file on every reload ***
+    for ( const QString &opt : parser.values( OPT_SET ) )
+    {
+        int idx = opt.indexOf( '=' );
+        if ( idx <= 0 )
+        {
+            qWarning() << "Ignoring invalid setting:" << opt;
+            continue;
+        }
+        overrides_[opt.left( idx ).trimmed()] = opt.mid( idx + 1 ).trimmed();
+    }
+
+    reload();
+
+    setupSigHup();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::reload
+ */
+//*****************************************************************************
+void FpConfig::reload()
+{
+QSettings settings( fileName_, QSettings::IniFormat );
+
+    setDefaults();
+
+    //*** file ***
+    for ( const QString &key : settings.allKeys() )
+    {
+        values_[key] = settings.value( key );
+    }
+
+    //*** command line ***
+    for ( auto it = overrides_.constBegin(); it != overrides_.constEnd(); ++it )
+    {
+        values_[it.key()] = it.value();
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::setupSigHup
+ */
+//*****************************************************************************
+void FpConfig::setupSigHup()
+{
+#ifdef Q_OS_UNIX
+struct sigaction hup;
+
+    if ( sigHupNotifier_ ) return;
+
+    if ( ::socketpair( AF_UNIX, SOCK_STREAM, 0, sigHupFd_ ) != 0 )
+    {
+        qWarning() << "Unable to create SIGHUP socket pair, reload disabled";
+        return;
+    }
+
+    sigHupNotifier_ = new QSocketNotifier( sigHupFd_[1], QSocketNotifier::Read, this );
+    connect( sigHupNotifier_, SIGNAL(activated(int)), SLOT(handleSigHup()) );
+
+    hup.sa_handler = sigHupHandler;
+    sigemptyset( &hup.sa_mask );
+    hup.sa_flags = SA_RESTART;
+
+    sigaction( SIGHUP, &hup, Q_NULLPTR );
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpConfig::handleSigHup
+ */
+//*****************************************************************************
+void FpConfig::handleSigHup()
+{
+#ifdef Q_OS_UNIX
+char a;
+
+    sigHupNotifier_->setEnabled( false );
+    if ( ::read( sigHupFd_[1], &a, sizeof(a) ) < 0 ) qWarning() << "SIGHUP read failed";
+    sigHupNotifier_->setEnabled( true );
+#endif
+
+    reload();
+
+    emit changed();
+}
@@ -0,0 +1,129 @@
+#ifndef FPCONFIG_H
+#define FPCONFIG_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QHash>
+
+class QSocketNotifier;
+class QCommandLineParser;
+
+
+//**********************************************************
+//********************* Config Keys ************************
+//**********************************************************
+
+//*** scale server ***
+const QString CFG_SCALE_ADDR          = "scale/address";
+const QString CFG_SCALE_PORT          = "scale/port";
+const QString CFG_CONNECT_TIMEOUT_MS  = "scale/connectTimeoutMs";
+
+//*** check-ins from the front desk program ***
+const QString CFG_CHECKIN_PORT        = "checkin/port";
+const QString CFG_CHECKIN_SOCKET      = "checkin/socket";       // Unix only, empty - UDP only
+
+//*** socket buffer sizes (0 = system default) ***
+const QString CFG_RECV_BUFFER_SIZE    = "net/recvBufferSize";
+const QString CFG_SEND_BUFFER_SIZE    = "net/sendBufferSize";
+
+//*** databases and sinks ***
+const QString CFG_ACCESS_DSN          = "db/accessDsn";         // empty disables
+const QString CFG_ACCESS_DATE_FIELD   = "db/accessDateField";   // empty - a row per weight, else a row per family per day
+const QString CFG_ACCESS_DEBOUNCE_MS  = "db/accessDebounceMs";  // bags held this long are one Access write, 0 disables
+const QString CFG_LOCAL_DB_PATH       = "db/localPath";
+const QString CFG_ARCHIVE_PATH        = "db/archivePath";
+const QString CFG_ARCHIVE_CHECK_MS    = "db/archiveCheckMs";
+const QString CFG_JOURNAL_PATH        = "db/journalPath";       // empty disables
+const QString CFG_SINK_QUEUE_DEPTH    = "sinks/queueDepth";
+const QString CFG_SINK_PROBE_MS       = "sinks/probeMs";        // 0 disables probing
+const QString CFG_DEAD_LETTER_DIR     = "sinks/deadLetterDir";  // weights a sink can't take, empty - dropped
+
+//*** binary event log (fpSvr --decode-log <file> to read) ***
+const QString CFG_EVENT_LOG_PATH      = "log/path";             // empty - window only
+const QString CFG_EVENT_LOG_MAX_BYTES = "log/maxBytes";
+const QString CFG_EVENT_LOG_KEEP      = "log/keepFiles";
+
+//*** family roster (Access table), IDs above those loaded are picked up on refresh ***
+const QString CFG_ROSTER_TABLE        = "roster/table";         // empty disables
+const QString CFG_ROSTER_KEY_FIELD    = "roster/keyField";
+const QString CFG_ROSTER_NAME_FIELD   = "roster/nameField";
+const QString CFG_ROSTER_REFRESH_MS   = "roster/refreshMs";
+
+//*** live weight from the scale (multicast) ***
+const QString CFG_LIVE_GROUP          = "live/group";           // empty disables
+const QString CFG_LIVE_PORT           = "live/port";
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The FpConfig class
+ *
+ * Runtime settings. Values come from the built in defaults, then the INI
+ * config file, then '--set key=value' command line overrides. On Unix the
+ * file is re-read on SIGHUP and changed() is emitted.
+ */
+//*****************************************************************************
+class FpConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor ***
+    explicit FpConfig( QObject *parent = nullptr );
+
+    //*** destructor ***
+    ~FpConfig();
+
+    //*** adds the config options to a command line parser ***
+    void addOptions( QCommandLineParser &parser );
+
+    //*** applies the parsed command line and loads the config file ***
+    void parse( const QCommandLineParser &parser );
+
+    //*** re-reads the config file (overrides still apply) ***
+    void reload();
+
+    //*** path of the config file ***
+    QString fileName() { return fileName_; }
+
+    //*** get a value ***
+    QVariant value( QString key ) { return values_.value( key ); }
+    QString  getString( QString key ) { return values_.value( key ).toString(); }
+    int      getInt( QString key ) { return values_.value( key ).toInt(); }
+
+signals:
+
+    //*** config was reloaded ***
+    void changed();
+
+private slots:
+
+    //*** SIGHUP arrived (via socket pair) ***
+    void handleSigHup();
+
+private:
+
+    //*** sets the built in defaults ***
+    void setDefaults();
+
+    //*** installs the SIGHUP handler ***
+    void setupSigHup();
+
+    //*** config file ***
+    QString fileName_;
+
+    //*** current values ***
+    QHash<QString,QVariant> values_;
+
+    //*** command line overrides ***
+    QHash<QString,QVariant> overrides_;
+
+    //*** SIGHUP notification ***
+    QSocketNotifier *sigHupNotifier_;
+};
+
+#endif // FPCONFIG_H
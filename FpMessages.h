@@ -0,0 +1,284 @@
+#ifndef FPMESSAGES_H
+#define FPMESSAGES_H
+
+//*****************************************************************************
+//*** Messages between fpSvr and the scale server. Shared by both ends, so  ***
+//*** no Qt types here.                                                     ***
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stddef.h>
+
+//*** longest family name in a check-in ***
+const int CHECKIN_NAME_MAX = 127;
+
+//*** check-in, front desk -> fpSvr -> scale ***
+typedef struct
+{
+    int32_t key;
+    char    name[CHECKIN_NAME_MAX+1];
+    int32_t numItems;
+    int64_t day;
+} t_CheckIn;
+
+const int CHECKIN_SIZE = sizeof( t_CheckIn );
+
+static_assert( sizeof(t_CheckIn) == 144 && offsetof(t_CheckIn, day) == 136, "t_CheckIn layout" );
+
+
+//*** header at the start of every framed message. size counts ***
+//*** the bytes after the size field, so a frame is size + 8.   ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+} t_MsgHeader;
+
+const int MSG_HEADER_SIZE = sizeof( t_MsgHeader );
+const int MSG_SIZE_OFFSET = 2 * sizeof( uint32_t );
+
+//*** larger size fields mean the stream is out of step ***
+const uint32_t MSG_MAX_SIZE = 4096;
+
+
+//*** weight report, scale -> fpSvr ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    int32_t  key;
+    float    weight;
+    int64_t  day;
+} t_WeightReport;
+
+const int WEIGHT_SIZE = sizeof( t_WeightReport );
+
+const int MAGIC_VAL = 0x3e3e3e3e;
+
+const int WEIGHT_REPORT_SIZE = sizeof( t_WeightReport );
+const int WEIGHT_SIZE_FIELD = WEIGHT_REPORT_SIZE - ( 2 * sizeof(uint32_t) );
+const int WEIGHT_REPORT_TYPE = 0x0001;
+
+static_assert( sizeof(t_WeightReport) == 32 && offsetof(t_WeightReport, day) == 24, "t_WeightReport layout" );
+
+
+//*** sequenced weight report, scale -> fpSvr. Kept by the scale   ***
+//*** until acknowledged and resent on reconnect, so fpSvr drops    ***
+//*** any seq it has already taken for the session.                 ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    int32_t  key;
+    float    weight;
+    int64_t  day;
+    uint32_t session;   // scale server run - seq restarts at 1
+    uint32_t seq;
+} t_WeightReportSeq;
+
+const int WEIGHT_REPORT_SEQ_SIZE = sizeof( t_WeightReportSeq );
+const int WEIGHT_REPORT_SEQ_TYPE = 0x0002;
+
+static_assert( sizeof(t_WeightReportSeq) == 40 && offsetof(t_WeightReportSeq, seq) == 36, "t_WeightReportSeq layout" );
+
+
+//*** acknowledgement, fpSvr -> scale. Cumulative - every report up ***
+//*** to and including seq is stored in the local database. Sent on ***
+//*** the check-in stream, told apart by MAGIC_VAL where a check-in ***
+//*** has its key.                                                  ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    uint32_t session;
+    uint32_t seq;
+} t_WeightAck;
+
+const int WEIGHT_ACK_SIZE = sizeof( t_WeightAck );
+const int WEIGHT_ACK_TYPE = 0x0003;
+
+static_assert( sizeof(t_WeightAck) == 20, "t_WeightAck layout" );
+
+
+//*** batch of sequenced weight reports, scale -> fpSvr. count ***
+//*** t_BatchEntry follow the header, seq ascending. Sent when ***
+//*** more than one report is due, e.g. the backlog after a    ***
+//*** reconnect. Acked like the single reports.                ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    uint32_t session;
+    uint32_t count;
+    uint32_t reserved;  // keeps the entries 8 byte aligned
+} t_WeightBatch;
+
+typedef struct
+{
+    int32_t  key;
+    float    weight;
+    int64_t  day;
+    uint32_t seq;
+    uint32_t reserved;
+} t_BatchEntry;
+
+const int WEIGHT_BATCH_SIZE = sizeof( t_WeightBatch );
+const int BATCH_ENTRY_SIZE  = sizeof( t_BatchEntry );
+const int WEIGHT_BATCH_TYPE = 0x0004;
+
+//*** entries per batch frame - keeps it under MSG_MAX_SIZE ***
+const int WEIGHT_BATCH_MAX = 128;
+
+static_assert( sizeof(t_WeightBatch) == 24, "t_WeightBatch layout" );
+static_assert( sizeof(t_BatchEntry) == 24 && offsetof(t_BatchEntry, day) == 8, "t_BatchEntry layout" );
+static_assert( WEIGHT_BATCH_SIZE + WEIGHT_BATCH_MAX * BATCH_ENTRY_SIZE - MSG_SIZE_OFFSET <= (int)MSG_MAX_SIZE, "batch too large" );
+
+
+//*** heartbeat, scale -> fpSvr every HEARTBEAT_INTERVAL_MS. fpSvr ***
+//*** drops the connection after HEARTBEAT_TIMEOUT_MS of silence.  ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    uint32_t session;
+    uint32_t lastSeq;   // newest report made this session (0 if none)
+} t_Heartbeat;
+
+const int HEARTBEAT_SIZE = sizeof( t_Heartbeat );
+const int HEARTBEAT_TYPE = 0x0005;
+
+const int HEARTBEAT_INTERVAL_MS = 5000;
+const int HEARTBEAT_TIMEOUT_MS  = 3 * HEARTBEAT_INTERVAL_MS;
+
+static_assert( sizeof(t_Heartbeat) == 20, "t_Heartbeat layout" );
+
+
+//*** scale command, fpSvr -> scale on the check-in stream. Tare ***
+//*** takes the current reading as zero (platform must be empty), ***
+//*** calibrate takes it as value (reference weight on the scale). ***
+//*** Sleep powers the HX711 down until wake, a check-in or another ***
+//*** command. Answered with a t_CommandResult.                     ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    float    value;
+} t_ScaleCommand;
+
+const int SCALE_COMMAND_SIZE   = sizeof( t_ScaleCommand );
+const int SCALE_TARE_TYPE      = 0x0006;
+const int SCALE_CALIBRATE_TYPE = 0x0007;
+const int SCALE_SLEEP_TYPE     = 0x0009;
+const int SCALE_WAKE_TYPE      = 0x000A;
+
+static_assert( sizeof(t_ScaleCommand) == 16, "t_ScaleCommand layout" );
+
+//*** command status ***
+const int32_t COMMAND_OK      = 0;
+const int32_t COMMAND_FAILED  = 1;    // no conversions, or a bad reading
+const int32_t COMMAND_REFUSED = 2;    // bad value
+
+//*** command result, scale -> fpSvr (every client) ***
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t type;
+    uint32_t command;   // SCALE_*_TYPE
+    int32_t  status;
+    float    value;     // weight read with the new settings
+} t_CommandResult;
+
+const int COMMAND_RESULT_SIZE = sizeof( t_CommandResult );
+const int COMMAND_RESULT_TYPE = 0x0008;
+
+static_assert( sizeof(t_CommandResult) == 24, "t_CommandResult layout" );
+
+
+//*** message registry - every framed type. size is the whole frame, ***
+//*** or the fixed part when entries of entrySize follow it.         ***
+typedef struct
+{
+    uint32_t    type;
+    uint32_t    size;
+    uint32_t    entrySize;  // 0 - fixed size
+    const char *name;
+} t_MsgType;
+
+const t_MsgType MSG_TYPES[] =
+{
+    { WEIGHT_REPORT_TYPE,     WEIGHT_REPORT_SIZE,     0,                "weight report" },
+    { WEIGHT_REPORT_SEQ_TYPE, WEIGHT_REPORT_SEQ_SIZE, 0,                "sequenced weight report" },
+    { WEIGHT_ACK_TYPE,        WEIGHT_ACK_SIZE,        0,                "weight ack" },
+    { WEIGHT_BATCH_TYPE,      WEIGHT_BATCH_SIZE,      BATCH_ENTRY_SIZE, "weight batch" },
+    { HEARTBEAT_TYPE,         HEARTBEAT_SIZE,         0,                "heartbeat" },
+    { SCALE_TARE_TYPE,        SCALE_COMMAND_SIZE,     0,                "tare" },
+    { SCALE_CALIBRATE_TYPE,   SCALE_COMMAND_SIZE,     0,                "calibrate" },
+    { COMMAND_RESULT_TYPE,    COMMAND_RESULT_SIZE,    0,                "command result" },
+    { SCALE_SLEEP_TYPE,       SCALE_COMMAND_SIZE,     0,                "sleep" },
+    { SCALE_WAKE_TYPE,        SCALE_COMMAND_SIZE,     0,                "wake" }
+};
+
+//*** registry entry for a type, NULL if unknown ***
+inline const t_MsgType *findMsgType( uint32_t type )
+{
+    for ( size_t i = 0; i < sizeof(MSG_TYPES) / sizeof(MSG_TYPES[0]); i++ )
+    {
+        if ( MSG_TYPES[i].type == type ) return &MSG_TYPES[i];
+    }
+
+    return NULL;
+}
+
+//*** TRUE if a frame of this many bytes is whole for its type ***
+inline bool isFrameValid( const t_MsgType *msgType, size_t frame )
+{
+    if ( msgType->entrySize == 0 ) return frame == msgType->size;
+
+    return frame >= msgType->size && ( frame - msgType->size ) % msgType->entrySize == 0;
+}
+
+
+//*** live weight, scale -> multicast group (10-20 per second) ***
+//*** Weights are in hundredths. A keyframe carries the full     ***
+//*** weight, a delta only the change since the previous frame.  ***
+//*** After a sequence gap, viewers wait for the next keyframe.  ***
+const uint16_t LIVE_MAGIC    = 0x4c57;   // 'WL'
+const uint8_t  LIVE_KEYFRAME = 1;
+const uint8_t  LIVE_DELTA    = 2;
+
+//*** frames between keyframes ***
+const int LIVE_KEYFRAME_INTERVAL = 16;
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t  type;
+    uint8_t  reserved;
+    uint32_t seq;
+} t_LiveHeader;
+
+typedef struct
+{
+    t_LiveHeader hdr;
+    int32_t      value;   // weight, hundredths
+    int32_t      key;     // family at the scale, 0 if none
+} t_LiveKeyframe;
+
+typedef struct
+{
+    t_LiveHeader hdr;
+    int16_t      delta;   // change since previous frame, hundredths
+    int16_t      reserved;
+} t_LiveDelta;
+
+static_assert( sizeof(t_LiveHeader) == 8 && sizeof(t_LiveKeyframe) == 16 && sizeof(t_LiveDelta) == 12, "live frame layout" );
+
+#endif // FPMESSAGES_H
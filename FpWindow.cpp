@@ -1,10 +1,15 @@
 #include "FpWindow.h"
 #include "ui_FpWindow.h"
 #include "FPDB.h"
+#include "WeightArchive.h"
+#include "WeightSink.h"
+#include "SinkWorker.h"
+#include "FpConfig.h"
+#include "LiveWeightReceiver.h"
+#include "WeightTrend.h"
+#include "EventLog.h"
+#include "ScaleLink.h"
 
-#include <QTcpSocket>
-#include <QUdpSocket>
-#include <QNetworkDatagram>
 #include <QDate>
 #include <QDebug>
 #include <QTimer>
@@ -12,22 +17,27 @@
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QSqlQuery>
+#include <QtConcurrent>
+#include <QDir>
+#include <QFileInfo>
+#include <QInputDialog>
 
 
-const quint16 SCALE_PORT = 29456;
-const QString SCALE_ADDR = "10.0.1.1";
-//const QString SCALE_ADDR = "127.0.0.1";
-//const QString SCALE_ADDR = "10.0.0.172";
+//*** addresses, ports and paths come from FpConfig ***
 
-const quint16 FP_PORT = 29457;
+const QString LOCAL_DB_LABEL = "LocalDB";
+const QString ACCESS_DB_LABEL = "AccessDB";
+const QString JOURNAL_LABEL = "Journal";
 
-const int CONNECT_TIMEOUT_MS = 1000;
+//*** sequenced reports held until the local database opens - the scale resends any beyond this. ***
+//*** Not below the scale's MAX_UNACKED, which caps its window, so one session fits.             ***
+const int MAX_HELD_REPORTS = 4096;
 
-const QString DB_DSN_NAME = "FP_WEIGHTS";
-const QString LOCAL_DB_PATH = "c:/fp/fp.db";
+//*** reading a session's last stored seq failed - try again after ***
+const int SEED_RETRY_MS = 1000;
 
-const QString LOCAL_DB_LABEL = "LocalDB";
-const QString ACCESS_DB_LABEL = "AccessDB";
+//*** recent visits shown when a family checks in ***
+const int CHECKIN_HISTORY_VISITS = 3;
 
 //*****************************************************************************
 //*****************************************************************************
@@ -36,22 +46,40 @@ const QString ACCESS_DB_LABEL = "AccessDB";
  * @param parent
  */
 //*****************************************************************************
-FpWindow::FpWindow(QWidget *parent) :
+FpWindow::FpWindow(FpConfig *config, QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::FpWindow)
 {
     ui->setupUi(this);
 
-    attemptingConnect_ = false;
-    isConnected_       = false;
-    tmOutCnt_          = 0;
-
-    //*** create new UDP port to listen for FP packets ***
-    udp_ = new QUdpSocket(this);
-    udp_->bind( QHostAddress::LocalHost, FP_PORT );
-
-    //*** connect to 'needed'msg in' slot ***
-    connect( udp_, SIGNAL(readyRead()), SLOT(handlePendingDatagrams() ) );
+    config_ = config;
+
+    //*** startup is done once every sink has opened (or failed) ***
+    startupTime_.start();
+
+    //*** events are recorded in binary, formatted for the window on the log thread ***
+    log_ = new EventLog( config_->getString( CFG_EVENT_LOG_PATH ),
+                         config_->getInt( CFG_EVENT_LOG_MAX_BYTES ),
+                         config_->getInt( CFG_EVENT_LOG_KEEP ), this );
+    connect( log_, SIGNAL(formatted(QString)), SLOT(handleLogLines(QString)) );
+    log_->start();
+
+    link_              = Q_NULLPTR;
+    localOpened_       = false;
+    accessSink_        = Q_NULLPTR;
+    localRosterLoaded_ = false;
+    rosterFromAccess_  = false;
+    rosterMaxKey_      = 0;
+    deliverySession_   = 0;
+    deliveredSeq_      = 0;
+    ackedSeq_          = 0;
+    ackPending_        = false;
+    seedSession_       = 0;
+    seeding_           = false;
+
+    //*** listen for check-ins and start trying to connect to scale server - first, so ***
+    //*** traffic is taken while the tray and databases come up                         ***
+    setupNetworking();
 
     //*** create the icons we need ***
     goodIcon_ = QIcon(":/images/good.png");
@@ -82,11 +110,20 @@ FpWindow::FpWindow(QWidget *parent) :
     //*** Title for the application window ***
     setWindowTitle( "Checkin Server" );
 
-    //*** setupDatabase ***
+    //*** setupDatabase - sinks open in parallel on their own threads ***
     setupDatabase();
 
-    //*** start trying to connect to scale server ***
-    setupNetworking();
+    //*** trend of the live reading, above the log ***
+    trend_ = new WeightTrend( this );
+    ui->verticalLayout->insertWidget( 1, trend_ );
+
+    //*** live reading in the status bar and the trend ***
+    live_ = new LiveWeightReceiver( this );
+    connect( live_, SIGNAL(liveWeight(float,qint32)), SLOT(handleLiveWeight(float,qint32)) );
+    setupLiveWeight();
+
+    //*** pick up config changes (SIGHUP) ***
+    connect( config_, SIGNAL(changed()), SLOT(handleConfigChanged()) );
 }
 
 
@@ -98,18 +135,20 @@ FpWindow::FpWindow(QWidget *parent) :
 //*****************************************************************************
 FpWindow::~FpWindow()
 {
-    //*** stop all comms signals ***
-    scaleSock_->disconnect();
+    //*** stop all comms, nothing more comes in for the sinks ***
+    link_->disconnect();
+    delete link_;
+
+    //*** close sinks, writing anything still queued ***
+    qDeleteAll( sinks_ );
 
-    if ( fpDB_ ) delete [] fpDB_;
-    if ( localDB_ ) delete [] localDB_;
+    //*** flush the event log, nothing more for the window ***
+    log_->disconnect();
+    delete log_;
 
     delete trayIcon_;
     delete trayIconMenu_;
 
-    delete udp_;
-    delete scaleSock_;
-
     delete ui;
 }
 
@@ -153,62 +192,136 @@ void FpWindow::iconActivated( QSystemTrayIcon::ActivationReason reason )
 //*****************************************************************************
 void FpWindow::handleShowWeight()
 {
-    QString msg = localDB_->getTodaysStatistics();
+    //*** query runs on a reader connection, show result when done ***
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>( this );
+
+    connect( watcher, &QFutureWatcher<QString>::finished, this, [=]()
+    {
+        QString msg = watcher->result();
 
-    ui->textOut->append( msg );
-    trayIcon_->showMessage( "Todays statistics", msg );
+        ui->textOut->append( msg );
+        trayIcon_->showMessage( "Todays statistics", msg );
+
+        watcher->deleteLater();
+    });
+
+    if ( !localDB() )
+    {
+        ui->textOut->append( "Local db not ready" );
+        watcher->deleteLater();
+        return;
+    }
+
+    watcher->setFuture( localDB()->getTodaysStatisticsAsync() );
 }
 
 //*****************************************************************************
 //*****************************************************************************
 /**
- * @brief FpWindow::handlePendingDatagrams
+ * @brief FpWindow::handleTare
  */
 //*****************************************************************************
-void FpWindow::handlePendingDatagrams()
+void FpWindow::handleTare()
 {
-    // process all datagrams that are pending
-    while (udp_->hasPendingDatagrams())
+    //*** result comes back as a message ***
+    link_->sendCommand( SCALE_TARE_TYPE, 0.0f );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleCalibrate
+ */
+//*****************************************************************************
+void FpWindow::handleCalibrate()
+{
+bool ok = false;
+
+    double weight = QInputDialog::getDouble( this, tr("Calibrate Scale"),
+                                             tr("Tare the empty scale first, then put a known weight on it and enter the weight:"),
+                                             10.0, 0.01, 1000.0, 2, &ok );
+    if ( !ok ) return;
+
+    link_->sendCommand( SCALE_CALIBRATE_TYPE, (float)weight );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleCheckIn
+ * @param key
+ * @param numItems
+ * @param name
+ */
+//*****************************************************************************
+void FpWindow::handleCheckIn( qint32 key, qint32 numItems, QString name )
+{
+    //*** latest name for the family ***
+    roster_.insert( key, name );
+
+    //*** save mapping of key to weight ***
+    //*** or clear weight if 'unchecked out' ***
+    if ( !keyToWeight_.contains( key ) || numItems == 0 )
     {
-        // get the datagram
-        QNetworkDatagram datagram = udp_->receiveDatagram();
+        //*** initialize to 0 ( or clear ) ***
+        keyToWeight_[key] = 0.0;
+    }
 
-        // pull out the bytes
-        QByteArray msg = datagram.data();
+    //*** recent visits for the volunteer ***
+    if ( numItems > 0 ) showFamilyHistory( key, name );
+}
 
-        if ( msg.size() != CHECKIN_SIZE )
-        {
-            qDebug() << "Invalid checkin message size received!!!";
-            continue;
-        }
 
-        t_CheckIn* ci = (t_CheckIn*)msg.data();
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::showFamilyHistory
+ * @param key
+ * @param name
+ */
+//*****************************************************************************
+void FpWindow::showFamilyHistory( qint32 key, QString name )
+{
+FPDB *db = localDB();
 
-        QString day = QDate::fromJulianDay( ci->day ).toString( "MM/dd/yyyy" );
+    if ( !db ) return;
 
-        QString buf = QString( "CHECKIN - key: %1  name: %2  items: %3  day: %4" )
-                .arg( ci->key ).arg( ci->name ).arg( ci->numItems ).arg( day );
+    //*** read on the reader pool (cached after the first check-in), shown when done ***
+    QFutureWatcher<t_FamilyHistory> *watcher = new QFutureWatcher<t_FamilyHistory>( this );
 
-        ui->textOut->append( buf );
+    connect( watcher, &QFutureWatcher<t_FamilyHistory>::finished, this, [=]()
+    {
+        t_FamilyHistory history = watcher->result();
+        QString buf = QString( "%1 (%2) : " ).arg( name ).arg( key );
 
-        //*** send to scale server if connected ***
-        if ( isConnected_ )
-        {
-            scaleSock_->write( (const char*)ci, CHECKIN_SIZE );
-        }
+        watcher->deleteLater();
 
-        //*** save mapping of key to name ***
-        keyToName_[ci->key] = QString( ci->name );
+        //*** read failed ***
+        if ( history.famId == ALL_FAMILIES ) return;
 
-        //*** save mapping of key to weight ***
-        //*** or clear weight if 'unchecked out' ***
-        if ( !keyToWeight_.contains( ci->key ) || ci->numItems == 0 )
+        if ( history.visits.isEmpty() )
         {
-            //*** initialize to 0 ( or clear ) ***
-            keyToWeight_[ci->key] = 0.0;
+            buf += "first visit";
+        }
+        else
+        {
+            buf += QString( "%1 bag(s), %2 lbs in all" ).arg( history.total.count ).arg( history.total.weight, 0, 'f', 1 );
+
+            for ( const t_DayTotal &visit : history.visits )
+            {
+                buf += QString( "\n    %1 : %2 bag(s), %3 lbs" )
+                       .arg( QDate::fromJulianDay( visit.day ).toString() )
+                       .arg( visit.count )
+                       .arg( visit.weight, 0, 'f', 1 );
+            }
         }
-    }
 
+        ui->textOut->append( buf );
+    });
+
+    watcher->setFuture( db->getFamilyHistoryAsync( key, CHECKIN_HISTORY_VISITS ) );
 }
 
 
@@ -228,6 +341,19 @@ void FpWindow::createActions()
 
     showWeightAction_ = new QAction(tr("Show &Weight Total"), this);
     connect(showWeightAction_, &QAction::triggered, this, &FpWindow::handleShowWeight );
+
+    tareAction_ = new QAction(tr("&Tare Scale"), this);
+    connect( tareAction_, &QAction::triggered, this, &FpWindow::handleTare );
+
+    calibrateAction_ = new QAction(tr("&Calibrate Scale..."), this);
+    connect( calibrateAction_, &QAction::triggered, this, &FpWindow::handleCalibrate );
+
+    //*** HX711 power down / up - a check-in wakes it as well ***
+    sleepAction_ = new QAction(tr("&Sleep Scale"), this);
+    connect( sleepAction_, &QAction::triggered, this, [=]() { link_->sendCommand( SCALE_SLEEP_TYPE, 0.0f ); } );
+
+    wakeAction_ = new QAction(tr("Wa&ke Scale"), this);
+    connect( wakeAction_, &QAction::triggered, this, [=]() { link_->sendCommand( SCALE_WAKE_TYPE, 0.0f ); } );
 }
 
 
@@ -243,6 +369,11 @@ void FpWindow::createTrayIcon()
     trayIconMenu_->addAction(showAction_);
     trayIconMenu_->addAction(hideAction_);
     trayIconMenu_->addAction(showWeightAction_);
+    trayIconMenu_->addSeparator();
+    trayIconMenu_->addAction(tareAction_);
+    trayIconMenu_->addAction(calibrateAction_);
+    trayIconMenu_->addAction(sleepAction_);
+    trayIconMenu_->addAction(wakeAction_);
 
     trayIcon_ = new QSystemTrayIcon(this);
     trayIcon_->setContextMenu( trayIconMenu_ );
@@ -281,20 +412,42 @@ void FpWindow::showBadIcon()
 //*****************************************************************************
 void FpWindow::setupNetworking()
 {
-    scaleSock_ = new QTcpSocket( this );
+    //*** sockets live on the link's own thread, everything here arrives queued ***
+    link_ = new ScaleLink( log_, linkSettings() );
 
-    //*** set up connection endpoint ***
-    scalePort_ = SCALE_PORT;
-    scaleAddr_.setAddress( SCALE_ADDR );
-
-    //*** socket connections ***
-    connect( scaleSock_, SIGNAL(connected()), SLOT(handleTcpConnected()));
-    connect( scaleSock_, SIGNAL(disconnected()), SLOT(handleTcpDisconnected()));
-    connect( scaleSock_, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(handleTcpError(QAbstractSocket::SocketError)));
-    connect( scaleSock_, SIGNAL(readyRead()), SLOT(handleDataIn()) );
+    connect( link_, SIGNAL(linkChanged(bool)), SLOT(handleLinkChanged(bool)) );
+    connect( link_, SIGNAL(checkIn(qint32,qint32,QString)), SLOT(handleCheckIn(qint32,qint32,QString)) );
+    connect( link_, SIGNAL(weightReport(qint32,float,qint64,quint32,quint32)), SLOT(handleWeightReport(qint32,float,qint64,quint32,quint32)) );
+    connect( link_, SIGNAL(message(QString)), ui->textOut, SLOT(append(QString)) );
 
     //*** start attempting to connect ***
-    attemptReconnect();
+    link_->start();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::setupLiveWeight
+ */
+//*****************************************************************************
+void FpWindow::setupLiveWeight()
+{
+QString group = config_->getString( CFG_LIVE_GROUP );
+
+    //*** nothing to show without a live reading ***
+    trend_->setVisible( !group.isEmpty() );
+
+    if ( group.isEmpty() )
+    {
+        live_->stop();
+        return;
+    }
+
+    if ( !live_->start( group, config_->getInt( CFG_LIVE_PORT ) ) )
+    {
+        ui->textOut->append( "Unable to join live weight group " + group );
+    }
 }
 
 
@@ -307,24 +460,75 @@ void FpWindow::setupNetworking()
 void FpWindow::setupDatabase()
 {
 QString buf;
+QString localPath = config_->getString( CFG_LOCAL_DB_PATH );
 
-    //*** Access database ***
-    fpDB_ = new FPDB( "QODBC3", DB_DSN_NAME, ACCESS_DB_LABEL, false, this );
+    //*** Access database (running total per family) ***
+    if ( !config_->getString( CFG_ACCESS_DSN ).isEmpty() )
+    {
+        accessSink_ = addSink( new DBSink( "QODBC3", config_->getString( CFG_ACCESS_DSN ), ACCESS_DB_LABEL, false, DBSink::Cumulative,
+                                           config_->getString( CFG_ACCESS_DATE_FIELD ), config_->getInt( CFG_ACCESS_DEBOUNCE_MS ) ) );
 
-    //*** local database ***
-    localDB_ = new FPDB( "QSQLITE", LOCAL_DB_PATH, LOCAL_DB_LABEL, true, this );
+        //*** roster table lives in the Access database ***
+        connect( accessSink_, &SinkWorker::opened, this, [=]( bool ok ) { if ( ok ) handleRosterRefresh(); } );
+    }
+
+    //*** local database (record per bag) ***
+    QDir().mkpath( QFileInfo( localPath ).absolutePath() );
+    localSink_ = addSink( new DBSink( "QSQLITE", localPath, LOCAL_DB_LABEL, true, DBSink::PerBag ), true );
 
-    if ( !fpDB_->isReady() )
+    //*** optional CSV journal ***
+    if ( !config_->getString( CFG_JOURNAL_PATH ).isEmpty() )
     {
-        buf = "Error opening Access db : " + fpDB_->lastError();
-        ui->textOut->append( buf );
+        addSink( new CsvSink( JOURNAL_LABEL, config_->getString( CFG_JOURNAL_PATH ) ) );
     }
-    if ( !localDB_->isReady() )
+
+    //*** archive once the local database is open, and take any reports held for it ***
+    connect( localSink_, &SinkWorker::opened, this, [=]( bool ok )
+    {
+        if ( ok )
+        {
+            //*** resends are recognised from what is stored, so not before this ***
+            localOpened_ = true;
+            releaseHeldReports();
+
+            //*** statistics take closed days from the archive ***
+            if ( archive_->isReady() && localDB() ) localDB()->setArchive( archive_ );
+            handleArchiveRollover();
+        }
+        handleRosterRefresh();
+    } );
+
+    //*** ack the scale once weights are stored ***
+    connect( localSink_, SIGNAL(committed(quint32,quint32)), SLOT(handleCommitted(quint32,quint32)) );
+    connect( &seedWatcher_, SIGNAL(finished()), SLOT(handleSeedDone()) );
+
+    //*** archive of closed days ***
+    archive_ = new WeightArchive( config_->getString( CFG_ARCHIVE_PATH ), this );
+
+    if ( !archive_->isReady() )
     {
-        buf = "Error opening local db : " + localDB_->lastError();
+        buf = "Error opening archive : " + archive_->lastError();
         ui->textOut->append( buf );
     }
 
+    //*** archive anything closed since last run, then check periodically ***
+    archiveTimer_ = new QTimer( this );
+    connect( archiveTimer_, SIGNAL(timeout()), SLOT(handleArchiveRollover()) );
+    connect( &archiveWatcher_, SIGNAL(finished()), SLOT(handleArchiveDone()) );
+    archiveTimer_->start( config_->getInt( CFG_ARCHIVE_CHECK_MS ) );
+
+    //*** family roster - loaded as the databases open, then refreshed ***
+    rosterTimer_ = new QTimer( this );
+    connect( rosterTimer_, SIGNAL(timeout()), SLOT(handleRosterRefresh()) );
+    connect( &rosterWatcher_, SIGNAL(finished()), SLOT(handleRosterLoaded()) );
+    rosterTimer_->start( config_->getInt( CFG_ROSTER_REFRESH_MS ) );
+
+    //*** open all sinks, each on its own thread ***
+    for ( SinkWorker *worker : sinks_ )
+    {
+        worker->start();
+    }
+
 #if 0
     QSqlDatabase db = QSqlDatabase::addDatabase("QODBC3");
     db.setDatabaseName( DB_DSN_NAME );
@@ -345,28 +549,72 @@ QString buf;
 //********************************************************************************
 //********************************************************************************
 /**
- * Closes the socket if it is open and starts an asynchronous connection attempt. On timeout, checkConnectionFailed() will be called.
- *
- * If we are already trying to connect, this function does nothing.
+ * Occurs when the scale link connects or disconnects.
+ */
+//********************************************************************************
+void FpWindow::handleLinkChanged( bool connected )
+{
+    if ( connected )
+    {
+        //*** the scale resends everything not acked, in order, so nothing is past a gap ***
+        droppedFrom_.clear();
+
+        ui->statusLbl->setText( "Connected" );
+        showGoodIcon();
+    }
+    else
+    {
+        ui->statusLbl->setText( "Disconnected" );
+        showBadIcon();
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Occurs for each weight report read by the scale link. Sequenced reports are
+ * held until the local database is open, and while the last seq stored for a
+ * new session is read, so resends can be recognised.
  */
 //********************************************************************************
-void FpWindow::attemptReconnect()
+void FpWindow::handleWeightReport( qint32 key, float weight, qint64 day, quint32 session, quint32 seq )
 {
-    // only continue if we're not already connecting
-    if (!attemptingConnect_)
+    //*** past a report dropped on overflow - taking it would leave a gap the acks cover ***
+    if ( seq && droppedFrom_.contains( session ) && seq >= droppedFrom_[session] ) return;
+
+    if ( seq && ( !localOpened_ || seeding_ || session != deliverySession_ ) )
+    {
+        //*** over the limit - this and all later reports of the session are dropped, ***
+        //*** never acked, so the scale resends them in order (see releaseHeldReports) ***
+        if ( heldReports_.size() >= MAX_HELD_REPORTS )
+        {
+            droppedFrom_[session] = seq;
+            ui->textOut->append( QString( "Too many held reports, session %1 will be resent from seq %2" ).arg( session ).arg( seq ) );
+            return;
+        }
+
+        t_HeldReport held = { key, weight, day, session, seq };
+        heldReports_.append( held );
+
+        if ( localOpened_ && !seeding_ ) seedDelivery( session );
+        return;
+    }
+
+    if ( !seq || isNewDelivery( seq ) )
     {
-       if (scaleSock_->isOpen())
-       {
-          scaleSock_->close();
-       }
+        storeWeight( key, weight, day, session, seq );
+        return;
+    }
 
-       // attempt the connect. we will check later if it succeeded.
-       isConnected_ = false;
-       attemptingConnect_ = true;
-       scaleSock_->connectToHost( scaleAddr_, scalePort_, QAbstractSocket::ReadWrite);
+    //*** resent after a reconnect - already have it ***
+    log_->record( LOG_DUPLICATE, key, weight, seq, day );
 
-       // after the timeout, check if we have connected. If the connection succeeds, connected() will handle going forward and this timeout will do nothing
-       QTimer::singleShot(CONNECT_TIMEOUT_MS, this, SLOT(checkConnectionFailed()));
+    //*** one ack for a run of duplicates ***
+    if ( !ackPending_ )
+    {
+        ackPending_ = true;
+        QMetaObject::invokeMethod( this, "handleAckDuplicates", Qt::QueuedConnection );
     }
 }
 
@@ -374,134 +622,479 @@ void FpWindow::attemptReconnect()
 //********************************************************************************
 //********************************************************************************
 /**
- * Called after the timeout is reached after attemptReconnect() is called. If the socket is still closed, it is assumed that an error occurred
- * and attempts a reconnect. If the socket is open, nothing more happens.
+ * Passes on the weight reports held while the local database was opening, or
+ * while a session was seeded, in the order they arrived.
  */
 //********************************************************************************
-void FpWindow::checkConnectionFailed()
+void FpWindow::releaseHeldReports()
 {
-    if (!isConnected_)
+QVector<t_HeldReport> held;
+
+    held.swap( heldReports_ );
+
+    for ( const t_HeldReport &report : held )
+    {
+        handleWeightReport( report.key, report.weight, report.day, report.session, report.seq );
+    }
+
+    //*** all taken - the scale only resends what was dropped on a new connection ***
+    if ( heldReports_.isEmpty() && !droppedFrom_.isEmpty() ) link_->resync();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleAckDuplicates
+ */
+//*****************************************************************************
+void FpWindow::handleAckDuplicates()
+{
+    ackPending_ = false;
+
+    //*** let the scale drop what we already have ***
+    if ( ackedSeq_ ) link_->sendAck( deliverySession_, ackedSeq_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::storeWeight
+ * @param key
+ * @param weight
+ * @param day
+ * @param session
+ * @param seq
+ */
+//*****************************************************************************
+void FpWindow::storeWeight( qint32 key, float weight, qint64 day, quint32 session, quint32 seq )
+{
+QString name = roster_.name( key );
+
+    //*** not checked in here and not in the roster - stored without a name ***
+    if ( name.isNull() )
     {
-       // connection failed, try again
-       tmOutCnt_++;
-       if ( tmOutCnt_ % 60 == 0 )
-       {
-          ui->textOut->append( "Unable to connect, retrying..." );
-       }
+        log_->record( LOG_UNKNOWN_FAMILY, key );
+    }
+
+    log_->record( LOG_WEIGHT, key, weight, seq, day, name );
 
-       attemptingConnect_ = false;
+    //*** maintain total if more than one record ***
+    keyToWeight_[key] += weight;
 
-       //*** stop connect ***
-       scaleSock_->abort();
+    t_WeightEntry entry;
+    entry.key     = key;
+    entry.weight  = weight;
+    entry.total   = keyToWeight_[key];
+    entry.day     = day;
+    entry.name    = name;
+    entry.session = session;
+    entry.seq     = seq;
 
-       //*** try connect again ***
-       attemptReconnect();
+    //*** hand to every sink, each writes on its own thread ***
+    for ( SinkWorker *worker : sinks_ )
+    {
+        worker->post( entry );
     }
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::isNewDelivery
+ * @param seq
+ * @return
+ */
+//*****************************************************************************
+bool FpWindow::isNewDelivery( quint32 seq )
+{
+    if ( seq <= deliveredSeq_ ) return false;
+
+    deliveredSeq_ = seq;
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::seedDelivery
+ * @param session
+ */
+//*****************************************************************************
+void FpWindow::seedDelivery( quint32 session )
+{
+FPDB *db = localDB();
+
+    //*** reopening - held until it is back (opened() releases them) ***
+    if ( !db ) return;
+
+    //*** first report of a session (or since we started) - resume from what is stored ***
+    seeding_     = true;
+    seedSession_ = session;
+    seedWatcher_.setFuture( QtConcurrent::run( db->readPool(), [=]() { return db->getLastSeq( session ); } ) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleSeedDone
+ */
+//*****************************************************************************
+void FpWindow::handleSeedDone()
+{
+    qint64 lastSeq = seedWatcher_.result();
+
+    seeding_ = false;
+
+    //*** a guess could double count resends - keep holding and ask again ***
+    if ( lastSeq < 0 )
+    {
+        ui->textOut->append( "Unable to read last stored seq : " + localSink_->sink()->lastError() );
+        QTimer::singleShot( SEED_RETRY_MS, this, [=]() { releaseHeldReports(); } );
+        return;
+    }
+
+    deliverySession_ = seedSession_;
+    deliveredSeq_    = (quint32)lastSeq;
+    ackedSeq_        = deliveredSeq_;
+
+    releaseHeldReports();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleCommitted
+ * @param session
+ * @param seq
+ */
+//*****************************************************************************
+void FpWindow::handleCommitted( quint32 session, quint32 seq )
+{
+    if ( session == deliverySession_ && seq > ackedSeq_ )
+    {
+        ackedSeq_ = seq;
+    }
+
+    link_->sendAck( session, seq );
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Compacts any closed days from the local database into the archive.
+ */
+//********************************************************************************
+void FpWindow::handleArchiveRollover()
+{
+FPDB *db = localDB();
+
+    //*** not open yet, or still running from last time ***
+    if ( !db || archiveWatcher_.isRunning() ) return;
+
+    //*** archive reads use a reader connection, keep it off the GUI thread ***
+    archiveWatcher_.setFuture( QtConcurrent::run( db->readPool(), [=]() { return archive_->rollover( db ); } ) );
+}
+
+
 //********************************************************************************
 //********************************************************************************
 /**
- * Occurs when the tcp socket connects. Sends each message that has been set.
+ * Reports the result of an archive rollover.
  */
 //********************************************************************************
-void FpWindow::handleTcpConnected()
+void FpWindow::handleArchiveDone()
 {
-    ui->textOut->append( "Connected..." );
+    int numDays = archiveWatcher_.result();
+
+    if ( numDays < 0 )
+    {
+        ui->textOut->append( "Error archiving weights : " + archive_->lastError() );
+    }
+    else if ( numDays > 0 )
+    {
+        ui->textOut->append( QString( "Archived %1 day(s)" ).arg( numDays ) );
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Creates a worker for a sink and reports the result when it opens.
+ *
+ * @param sink  The sink, owned by the worker
+ * @param acks  TRUE if its commits ack the scale (the scale's window bounds its queue)
+ * @return      The worker (started by setupDatabase)
+ */
+//********************************************************************************
+SinkWorker *FpWindow::addSink( WeightSink *sink, bool acks )
+{
+QString name = sink->name();
+QString deadLetterDir = config_->getString( CFG_DEAD_LETTER_DIR );
+QString deadLetterPath;
+
+    if ( !deadLetterDir.isEmpty() )
+    {
+        QDir().mkpath( deadLetterDir );
+        deadLetterPath = QDir( deadLetterDir ).filePath( name + ".dead.csv" );
+    }
+
+    SinkWorker *worker = new SinkWorker( sink, config_->getInt( CFG_SINK_QUEUE_DEPTH ), config_->getInt( CFG_SINK_PROBE_MS ),
+                                         deadLetterPath, acks );
+
+    //*** reported on open and whenever the sink is lost or reopened ***
+    connect( worker, &SinkWorker::opened, this, [=]( bool ok, QString error )
+    {
+        if ( ok )
+            ui->textOut->append( name + " ready" );
+        else
+            ui->textOut->append( name + " unavailable, retrying : " + error );
 
-    ui->statusLbl->setText( "Connected" );
+        stageDone( name );
+    });
+    startupPending_.append( name );
+    connect( worker, SIGNAL(writeFailed(QString)), SLOT(handleSinkError(QString)) );
 
-    isConnected_ = true;
-    attemptingConnect_ = false;
-    tmOutCnt_ = 0;
+    sinks_.append( worker );
 
-    showGoodIcon();
+    return worker;
 }
 
 
 //********************************************************************************
 //********************************************************************************
 /**
- * Occurs when the tcp socket disconnects. Attempts a reconnect.
+ * Starts the next roster load: names already recorded in the local database
+ * first, then families added to the Access roster table since the last load.
  */
 //********************************************************************************
-void FpWindow::handleTcpDisconnected()
+void FpWindow::handleRosterRefresh()
 {
-    ui->textOut->append( "Server disconnected, reconnecting..." );
+FPDB *db = localDB();
 
-    ui->statusLbl->setText( "Disconnected" );
+    //*** one load at a time ***
+    if ( rosterWatcher_.isRunning() ) return;
 
-    attemptingConnect_ = false;
-    attemptReconnect();
+    if ( !localRosterLoaded_ && db )
+    {
+        rosterFromAccess_ = false;
+        rosterWatcher_.setFuture( QtConcurrent::run( db->readPool(), [=]()
+        {
+            QVector<t_FamilyName> names;
+            db->getRecordedNames( names );
+            return names;
+        } ) );
+        return;
+    }
 
-    showBadIcon();
+    QString table     = config_->getString( CFG_ROSTER_TABLE );
+    QString keyField  = config_->getString( CFG_ROSTER_KEY_FIELD );
+    QString nameField = config_->getString( CFG_ROSTER_NAME_FIELD );
+    qint32  afterKey  = rosterMaxKey_;
+
+    db = accessDB();
+    if ( table.isEmpty() || !db ) return;
+
+    rosterFromAccess_ = true;
+    rosterWatcher_.setFuture( QtConcurrent::run( db->readPool(), [=]()
+    {
+        QVector<t_FamilyName> names;
+        db->getFamilyNames( table, keyField, nameField, afterKey, names );
+        return names;
+    } ) );
 }
 
 
 //********************************************************************************
 //********************************************************************************
 /**
- * Occurs when there is data available on the TCP socket (from the scale)
+ * Merges a finished roster load.
  */
 //********************************************************************************
-void FpWindow::handleDataIn()
+void FpWindow::handleRosterLoaded()
 {
-t_WeightReport wr;
+    QVector<t_FamilyName> names = rosterWatcher_.result();
 
-    //*** get data ***
-    while ( scaleSock_->bytesAvailable() >= WEIGHT_SIZE )
+    if ( rosterFromAccess_ )
     {
-        //*** read structs worth of data ***
-        if ( scaleSock_->read( (char*)&wr, WEIGHT_SIZE ) == WEIGHT_SIZE )
+        //*** next refresh only asks for newer IDs ***
+        for ( const t_FamilyName &fam : names )
         {
-            if ( wr.magic == MAGIC_VAL && wr.type == WEIGHT_REPORT_TYPE )
-            {
-                QString buf;
-                buf = QString( "FROM PI - Key: %1  name: %2  weight: %3  day: %4")
-                        .arg( wr.key )
-                        .arg( keyToName_[wr.key] )
-                        .arg( wr.weight )
-                        .arg( QDate::fromJulianDay(wr.day).toString() );
-                ui->textOut->append( buf );
-
-                //*** add data to databases ***
-
-                //*** Access db ***
-                if ( fpDB_->isReady() )
-                {
-                    //*** add weight (maintain total if more than one record) ***
-                    keyToWeight_[wr.key] += wr.weight;
-                    fpDB_->addRecord( wr.key, keyToWeight_[wr.key] );
-                }
-
-                //*** local db ***
-                if ( localDB_->isReady() )
-                {
-                    localDB_->addRecord( wr.key, wr.weight, wr.day, keyToName_[wr.key] );
-                }
-            }
+            if ( fam.key > rosterMaxKey_ ) rosterMaxKey_ = fam.key;
         }
     }
+    else
+    {
+        localRosterLoaded_ = true;
+    }
+
+    roster_.merge( names );
+
+    if ( !names.isEmpty() )
+    {
+        ui->textOut->append( QString( "Roster: %1 families (%2 loaded)" ).arg( roster_.size() ).arg( names.size() ) );
+    }
+
+    //*** local names in - go on to the roster table ***
+    if ( !rosterFromAccess_ ) handleRosterRefresh();
 }
 
 
 //********************************************************************************
 //********************************************************************************
 /**
- * Occurs if an error is thrown by the TCP socket. Logs the error.
- *
- * This does not attempt a reconnect as many of the error types happen immediately on connectToHost and would result in an infinite loop.
- * If an error occurs and the socket disconnects, a reconnect will be attempted the next time setInfo is called.
+ * Returns the Access database once its sink has opened, otherwise NULL.
+ */
+//********************************************************************************
+FPDB *FpWindow::accessDB()
+{
+    if ( !accessSink_ || !accessSink_->isReady() ) return Q_NULLPTR;
+
+    FPDB *db = static_cast<DBSink*>( accessSink_->sink() )->db();
+
+    //*** not while the sink thread is reopening it ***
+    return ( db && db->isReady() ) ? db : Q_NULLPTR;
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Returns the local database once its sink has opened, otherwise NULL.
+ */
+//********************************************************************************
+FPDB *FpWindow::localDB()
+{
+    if ( !localSink_ || !localSink_->isReady() ) return Q_NULLPTR;
+
+    FPDB *db = static_cast<DBSink*>( localSink_->sink() )->db();
+
+    //*** not while the sink thread is reopening it ***
+    return ( db && db->isReady() ) ? db : Q_NULLPTR;
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Marks a startup stage (a sink's first open) done, and reports the startup
+ * time once the last one is.
  *
- * @param e  The type of error that occurred
+ * @param stage  The stage name
+ */
+//********************************************************************************
+void FpWindow::stageDone( QString stage )
+{
+    //*** later reopens don't count ***
+    if ( !startupPending_.removeOne( stage ) ) return;
+
+    if ( startupPending_.isEmpty() )
+    {
+        ui->textOut->append( QString( "Started in %1 ms" ).arg( startupTime_.elapsed() ) );
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Logs a sink write error.
+ */
+//********************************************************************************
+void FpWindow::handleSinkError( QString error )
+{
+    ui->textOut->append( "Sink error : " + error );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::linkSettings
+ * @return
  */
+//*****************************************************************************
+t_LinkSettings FpWindow::linkSettings()
+{
+t_LinkSettings settings;
+
+    settings.scaleAddr        = config_->getString( CFG_SCALE_ADDR );
+    settings.scalePort        = config_->getInt( CFG_SCALE_PORT );
+    settings.checkinPort      = config_->getInt( CFG_CHECKIN_PORT );
+    settings.checkinSocket    = config_->getString( CFG_CHECKIN_SOCKET );
+    settings.connectTimeoutMs = config_->getInt( CFG_CONNECT_TIMEOUT_MS );
+    settings.recvBufferSize   = config_->getInt( CFG_RECV_BUFFER_SIZE );
+    settings.sendBufferSize   = config_->getInt( CFG_SEND_BUFFER_SIZE );
+
+    return settings;
+}
+
+
+//********************************************************************************
 //********************************************************************************
-void FpWindow::handleTcpError( QAbstractSocket::SocketError e )
+/**
+ * Occurs when the config is reloaded (SIGHUP). Network settings are applied
+ * now, database settings on the next restart.
+ */
+//********************************************************************************
+void FpWindow::handleConfigChanged()
+{
+    ui->textOut->append( "Config reloaded from " + config_->fileName() );
+
+    //*** applied on the link thread ***
+    link_->configure( linkSettings() );
+
+    archiveTimer_->setInterval( config_->getInt( CFG_ARCHIVE_CHECK_MS ) );
+
+    setupLiveWeight();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleLiveWeight
+ * @param weight
+ * @param key
+ */
+//*****************************************************************************
+void FpWindow::handleLiveWeight( float weight, qint32 key )
 {
-    if ( e != QAbstractSocket::ConnectionRefusedError )
+QString buf;
+
+    if ( key != 0 && roster_.contains( key ) )
     {
-        ui->textOut->append( "TCP Error: " + scaleSock_->errorString() );
-        qDebug() << "Error (" << e << "): " << scaleSock_->errorString();
+        buf = QString( "Scale: %1  (%2)" ).arg( weight, 0, 'f', 2 ).arg( roster_.name( key ) );
     }
+    else
+    {
+        buf = QString( "Scale: %1" ).arg( weight, 0, 'f', 2 );
+    }
+
+    //*** replaced by the next reading ***
+    ui->statusBar->showMessage( buf );
+
+    trend_->addSample( weight );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief FpWindow::handleLogLines
+ * @param lines
+ */
+//*****************************************************************************
+void FpWindow::handleLogLines( QString lines )
+{
+    //*** one append per batch ***
+    ui->textOut->append( lines );
 }
@@ -3,50 +3,38 @@
 
 #include <QMainWindow>
 #include <QSystemTrayIcon>
-#include <QUdpSocket>
-#include <QHostAddress>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+
+#include "FpMessages.h"
+#include "FamilyRoster.h"
+#include "ScaleLink.h"
 
 namespace Ui {
 class FpWindow;
 }
 
 //class QLocalServer;
-class QTcpSocket;
-class QUdpSocket;
 class FPDB;
-
-const int NAME_MAX = 127;
-
-typedef struct
-{
-    int key;
-    char name[NAME_MAX+1];
-    int  numItems;
-    qint64 day;
-} t_CheckIn;
-
-const int CHECKIN_SIZE = sizeof( t_CheckIn );
+class WeightArchive;
+class SinkWorker;
+class WeightSink;
+class FpConfig;
+class LiveWeightReceiver;
+class WeightTrend;
+class EventLog;
 
 
+//*** sequenced weight report, held until the local database is open ***
 typedef struct
 {
-    quint32 magic;
-    quint32 size;
-    quint32 type;
-    int     key;
+    qint32  key;
     float   weight;
     qint64  day;
-} t_WeightReport;
-
-const int WEIGHT_SIZE = sizeof( t_WeightReport );
-
-const int MAGIC_VAL = 0x3e3e3e3e;
-
-const int WEIGHT_REPORT_SIZE = sizeof( t_WeightReport );
-const int WEIGHT_SIZE_FIELD = WEIGHT_REPORT_SIZE - ( 2 * sizeof(quint32) );
-const int WEIGHT_REPORT_TYPE = 0x0001;
-
+    quint32 session;
+    quint32 seq;
+} t_HeldReport;
 
 
 //*****************************************************************************
@@ -60,7 +48,7 @@ class FpWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit FpWindow(QWidget *parent = nullptr);
+    explicit FpWindow(FpConfig *config, QWidget *parent = nullptr);
     ~FpWindow();
 
 private slots:
@@ -68,63 +56,43 @@ private slots:
     void iconActivated( QSystemTrayIcon::ActivationReason reason );
     void handleShowWeight();
 
-    //*** local socket data ***
-    void handlePendingDatagrams();
-
-    //********************************************************************************
-    //********************************************************************************
-    /**
-     * Closes the socket if it is open and starts an asynchronous connection attempt. On timeout, checkConnectionFailed() will be called.
-     *
-     * If we are already trying to connect, this function does nothing.
-     */
-    //********************************************************************************
-    void attemptReconnect();
-
-
-    //********************************************************************************
-    //********************************************************************************
-    /**
-     * Called after the timeout is reached after attemptReconnect() is called. If the socket is still closed, it is assumed that an error occurred
-     * and attempts a reconnect. If the socket is open, nothing more happens.
-     */
-    //********************************************************************************
-    void checkConnectionFailed();
-
-
-    //********************************************************************************
-    //********************************************************************************
-    /**
-     * Occurs when the tcp socket connects. Sends each message that has been set.
-     */
-    //********************************************************************************
-    void handleTcpConnected();
-
-
-    //********************************************************************************
-    //********************************************************************************
-    /**
-     * Occurs when the tcp socket disconnects. Attempts a reconnect.
-     */
-    //********************************************************************************
-    void handleTcpDisconnected();
-
-
-    //********************************************************************************
-    //********************************************************************************
-    /**
-     * Occurs if an error is thrown by the TCP socket. Logs the error.
-     *
-     * This does not attempt a reconnect as many of the error types happen immediately on connectToHost and would result in an infinite loop.
-     * If an error occurs and the socket disconnects, a reconnect will be attempted the next time setInfo is called.
-     *
-     * @param e  The type of error that occurred
-     */
-    //********************************************************************************
-    void handleTcpError( QAbstractSocket::SocketError e );
-
-
-    void handleDataIn();
+    //*** scale commands from the tray menu ***
+    void handleTare();
+    void handleCalibrate();
+
+    //*** from the scale link ***
+    void handleLinkChanged( bool connected );
+    void handleCheckIn( qint32 key, qint32 numItems, QString name );
+    void handleWeightReport( qint32 key, float weight, qint64 day, quint32 session, quint32 seq );
+
+    //*** acks the scale after resent reports were dropped ***
+    void handleAckDuplicates();
+
+    //*** config reloaded ***
+    void handleConfigChanged();
+
+    //*** weight sink status ***
+    void handleSinkError( QString error );
+
+    //*** local database has stored sequenced weights up to seq ***
+    void handleCommitted( quint32 session, quint32 seq );
+
+    //*** last stored seq of a new session has been read ***
+    void handleSeedDone();
+
+    //*** compacts closed days into the archive ***
+    void handleArchiveRollover();
+    void handleArchiveDone();
+
+    //*** loads / refreshes the family roster off the GUI thread ***
+    void handleRosterRefresh();
+    void handleRosterLoaded();
+
+    //*** live reading from the scale ***
+    void handleLiveWeight( float weight, qint32 key );
+
+    //*** events formatted by the log thread ***
+    void handleLogLines( QString lines );
 
 private:
 
@@ -136,29 +104,65 @@ private:
 
     void setupNetworking();
 
+    //*** joins the live weight group (if configured) ***
+    void setupLiveWeight();
+
+    //*** network settings from the config ***
+    t_LinkSettings linkSettings();
+
     void setupDatabase();
 
+    //*** creates a sink worker, logging its open result - 'acks' for the sink whose commits ack the scale ***
+    SinkWorker *addSink( WeightSink *sink, bool acks = false );
+
+    //*** local database, NULL until opened ***
+    FPDB *localDB();
+
+    //*** Access database, NULL if disabled or not opened ***
+    FPDB *accessDB();
+
+    //*** shows a family's recent visits when it checks in ***
+    void showFamilyHistory( qint32 key, QString name );
+
+    //*** hands a weight from the scale to every sink ***
+    void storeWeight( qint32 key, float weight, qint64 day, quint32 session, quint32 seq );
+
+    //*** FALSE if this report was already taken (resent by the scale) ***
+    bool isNewDelivery( quint32 seq );
+
+    //*** reads the last stored seq of a new session off the GUI thread ***
+    void seedDelivery( quint32 session );
+
+    //*** passes on reports held until the local database opened or a session was seeded ***
+    void releaseHeldReports();
+
+    //*** a startup stage (sink) has finished its first open ***
+    void stageDone( QString stage );
 
 
     Ui::FpWindow *ui;
 
-    //*** Windows 'Named Pipe' server ***
-    QUdpSocket *udp_;
+    //*** runtime settings ***
+    FpConfig *config_;
 
-    //*** client socket to talk to scale server ***
-    QTcpSocket *scaleSock_;
+    //*** binary event log ***
+    EventLog *log_;
 
-    QHostAddress scaleAddr_;
-    quint16      scalePort_;
+    //*** check-in listener and scale server connection, on their own thread ***
+    ScaleLink *link_;
 
-    bool attemptingConnect_;   // True if we are attempting to connect, false if we are connected or disconnected
-    bool isConnected_;         // True if we are connected to the TCP server
-    int tmOutCnt_;
+    //*** live weight multicast ***
+    LiveWeightReceiver *live_;
+    WeightTrend        *trend_;
 
     //*** menu actions ***
     QAction *showWeightAction_;
     QAction *showAction_;
     QAction *hideAction_;
+    QAction *tareAction_;
+    QAction *calibrateAction_;
+    QAction *sleepAction_;
+    QAction *wakeAction_;
 
     //*** tray icon ***
     QSystemTrayIcon *trayIcon_;
@@ -170,11 +174,52 @@ private:
     QIcon goodIcon_;
     QIcon badIcon_;
 
-    QHash<int,QString> keyToName_;
+    //*** family names, never queried on the weight path ***
+    FamilyRoster roster_;
+    QTimer      *rosterTimer_;
+    bool         localRosterLoaded_;
+    bool         rosterFromAccess_;
+    qint32       rosterMaxKey_;
+
+    //*** roster load running on a reader pool ***
+    QFutureWatcher< QVector<t_FamilyName> > rosterWatcher_;
+
     QHash<int,float>   keyToWeight_;
 
-    FPDB *fpDB_;
-    FPDB *localDB_;
+    //*** where weights are stored, each on its own worker thread ***
+    QList<SinkWorker*> sinks_;
+    SinkWorker        *localSink_;
+    SinkWorker        *accessSink_;
+    bool               localOpened_;
+
+    //*** sequenced reports - highest taken and highest stored for the session ***
+    quint32 deliverySession_;
+    quint32 deliveredSeq_;
+    quint32 ackedSeq_;
+    bool    ackPending_;
+
+    //*** a new session's last stored seq, read on the local reader pool ***
+    QFutureWatcher<qint64> seedWatcher_;
+    quint32                seedSession_;
+    bool                   seeding_;
+
+    //*** reports from before the local database opened, or while a session is seeded ***
+    QVector<t_HeldReport> heldReports_;
+
+    //*** first seq dropped when the held reports overflowed, by session - later ***
+    //*** ones are dropped too until the scale resends them after a reconnect    ***
+    QHash<quint32,quint32> droppedFrom_;
+
+    //*** startup - sinks still on their first open ***
+    QElapsedTimer startupTime_;
+    QStringList   startupPending_;
+
+    //*** columnar archive of closed days ***
+    WeightArchive *archive_;
+    QTimer        *archiveTimer_;
+
+    //*** rollover running on the local db reader pool ***
+    QFutureWatcher<int> archiveWatcher_;
 };
 
 #endif // FPWINDOW_H
@@ -0,0 +1,147 @@
+#include "GpioCdev.h"
+#include <linux/gpio.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+
+
+//*****************
+//*** CONSTANTS ***
+//*****************
+
+//*** kernel event buffer (edges queued while we are busy) ***
+const int EVENT_BUFFER_SIZE = 64;
+
+//*** most events taken per read ***
+const int MAX_EVENTS_PER_READ = 16;
+
+
+//*****************************************************************************
+//*****************************************************************************
+static int G_requestLine( int chipFd, int line, unsigned long long flags, const char *consumer )
+{
+struct gpio_v2_line_request req;
+
+    memset( &req, 0, sizeof(req) );
+
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    req.config.flags = flags;
+    req.event_buffer_size = EVENT_BUFFER_SIZE;
+    strncpy( req.consumer, consumer, sizeof(req.consumer) - 1 );
+
+    if ( ioctl( chipFd, GPIO_V2_GET_LINE_IOCTL, &req ) < 0 ) return -1;
+
+    return req.fd;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool GPIO_requestLines( const char *chipPath, int dtLine, int sckLine, const char *consumer, GpioLines &lines )
+{
+int chipFd = -1;
+
+    lines.dtFd  = -1;
+    lines.sckFd = -1;
+
+    chipFd = open( chipPath, O_RDWR | O_CLOEXEC );
+    if ( chipFd < 0 ) return false;
+
+    //*** data - input with falling edge events, same clock as H_getNSecTime ***
+    lines.dtFd = G_requestLine( chipFd, dtLine,
+                                GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING |
+                                GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME,
+                                consumer );
+
+    //*** clock - output, starts low (chip powered up) ***
+    lines.sckFd = G_requestLine( chipFd, sckLine, GPIO_V2_LINE_FLAG_OUTPUT, consumer );
+
+    //*** line requests stay valid without the chip fd ***
+    close( chipFd );
+
+    if ( lines.dtFd < 0 || lines.sckFd < 0 )
+    {
+        GPIO_releaseLines( lines );
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void GPIO_releaseLines( GpioLines &lines )
+{
+    if ( lines.dtFd >= 0 ) close( lines.dtFd );
+    if ( lines.sckFd >= 0 ) close( lines.sckFd );
+
+    lines.dtFd  = -1;
+    lines.sckFd = -1;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+int GPIO_getDT( const GpioLines &lines )
+{
+struct gpio_v2_line_values vals;
+
+    vals.bits = 0;
+    vals.mask = 1;
+
+    if ( ioctl( lines.dtFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &vals ) < 0 ) return 0;
+
+    return (int)( vals.bits & 1 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void GPIO_setSCK( const GpioLines &lines, int val )
+{
+struct gpio_v2_line_values vals;
+
+    vals.bits = val ? 1 : 0;
+    vals.mask = 1;
+
+    ioctl( lines.sckFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &vals );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+int GPIO_readEdges( const GpioLines &lines, NSecTime *times, int maxEvents, int timeoutMs )
+{
+struct gpio_v2_line_event events[MAX_EVENTS_PER_READ];
+struct pollfd pfd;
+int numEdges = 0;
+
+    pfd.fd = lines.dtFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int rtn = poll( &pfd, 1, timeoutMs );
+    if ( rtn == 0 ) return 0;
+    if ( rtn < 0 ) return ( errno == EINTR ) ? 0 : -1;
+
+    if ( maxEvents > MAX_EVENTS_PER_READ ) maxEvents = MAX_EVENTS_PER_READ;
+
+    //*** one read takes everything queued (up to maxEvents) ***
+    ssize_t len = read( lines.dtFd, events, sizeof(events[0]) * maxEvents );
+    if ( len < 0 ) return ( errno == EINTR || errno == EAGAIN ) ? 0 : -1;
+
+    for ( int i=0; i<(int)( len / sizeof(events[0]) ); i++ )
+    {
+        if ( events[i].id == GPIO_V2_LINE_EVENT_FALLING_EDGE )
+        {
+            times[numEdges++] = (NSecTime)events[i].timestamp_ns;
+        }
+    }
+
+    return numEdges;
+}
@@ -0,0 +1,39 @@
+#ifndef GPIOCDEV_H
+#define GPIOCDEV_H
+
+    //****************
+    //*** typedefs ***
+    //****************
+
+   //*** same as HX711.h ***
+   typedef long long NSecTime;
+
+   //*** line request file descriptors ***
+   typedef struct
+   {
+      int dtFd;      // data line - input, falling edge events
+      int sckFd;     // clock line - output
+   } GpioLines;
+
+
+   //************************
+   //*** Public Functions ***
+   //************************
+
+   //*** requests the lines from a GPIO character device (e.g. /dev/gpiochip0) ***
+   //*** edge events carry CLOCK_REALTIME kernel timestamps                   ***
+   //*** (works with the gpio-sim module for testing off the Pi)              ***
+   bool GPIO_requestLines( const char *chipPath, int dtLine, int sckLine, const char *consumer, GpioLines &lines );
+
+   void GPIO_releaseLines( GpioLines &lines );
+
+   int  GPIO_getDT( const GpioLines &lines );
+
+   void GPIO_setSCK( const GpioLines &lines, int val );
+
+   //*** waits for edge events and reads up to maxEvents in one read ***
+   //*** returns number of falling edges, 0 on timeout, -1 on error  ***
+   int  GPIO_readEdges( const GpioLines &lines, NSecTime *times, int maxEvents, int timeoutMs );
+
+
+#endif
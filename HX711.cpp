@@ -1,10 +1,25 @@
 #include "HX711.h"
+#include "HX711Raw.h"
+#include "GpioCdev.h"
 #include <time.h>
 #include <wiringPi.h>
 #include <stdio.h>
 #include <array>
 #include <list>
 #include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+#include <limits.h>
 
 
 //*****************
@@ -13,7 +28,25 @@
 const long NSecsPerSec = 1000000000;
 const long USecsPerSec = 1000000;
 
-const int SAMPLES_PER_WEIGHT = 8;
+//*** filter window (samples averaged per weight) ***
+const int DEFAULT_SAMPLES_PER_WEIGHT = 8;
+const int MAX_SAMPLES_PER_WEIGHT = 64;
+
+//*** edge events taken per read, and poll timeout (checks for shutdown) ***
+const int EDGE_BATCH = 16;
+const int EDGE_POLL_MS = 100;
+
+//*** poll timeout while powered down - no edges are coming ***
+const int EDGE_IDLE_POLL_MS = 1000;
+
+//*** output settles 4 conversions after power up (400 ms at 10 SPS) ***
+const int WAKE_DISCARD_SAMPLES = 4;
+
+//*** HX711 powers down if SCK stays high for 60 us - keep a margin ***
+const NSecTime MAX_CLOCK_HIGH_NS = 50000;
+
+//*** data is good until the next conversion (100 ms at 10 SPS) ***
+const NSecTime MAX_WAKE_LATENCY_NS = 20000000;
 
 //*****************
 //*** VARIABLES ***
@@ -26,10 +59,50 @@ static int tare_ = 0;
 //*** produced as part of calibration
 static double scale_ = 0.0;
 
+//*** tare from init / calibration, auto zero moves tare_ away from it ***
+static int calibratedTare_ = 0;
+
+//*** auto zero settings (off by default) ***
+static HX711_AutoZero autoZero_ = { false, 0.05, 200, 20, 5000, 5000 };
+
+//*** reference points of the last calibration ***
+static int refTareRaw_ = 0;
+static int refWeightRaw_ = 0;
+static float refWeight_ = 0;
+static NSecTime calibrationTime_ = 0;
+
+//*** auto zero history ***
+static int numAdjustments_ = 0;
+static int numLimited_ = 0;
+static NSecTime lastAdjustTime_ = 0;
+
+//*** number of samples averaged per weight ***
+static int samplesPerWeight_ = DEFAULT_SAMPLES_PER_WEIGHT;
+
 //*** GPIO pins ***
 static int DT_Pin_ = 0;
 static int SCK_Pin_ = 0;
 
+//*** GPIO backend ***
+static HX711_Backend backend_ = HX711_BACKEND_WIRINGPI;
+static std::string chipPath_ = "/dev/gpiochip0";
+
+//*** character device lines and edge thread ***
+static GpioLines lines_ = { -1, -1 };
+static pthread_t edgeThread_;
+static volatile bool edgeThreadRunning_ = false;
+
+//*** real time options, applied once from the sampling thread ***
+static HX711_RtOptions rtOptions_ = { 0, -1, false };
+static volatile bool rtApplied_ = false;
+
+//*** sampling thread timing ***
+static std::atomic<long long> numSamples_( 0 );
+static std::atomic<long long> numDeadlineMisses_( 0 );
+static std::atomic<long long> numLateStarts_( 0 );
+static std::atomic<long long> maxClockHigh_( 0 );
+static std::atomic<long long> maxWakeLatency_( 0 );
+
 //*** last value read and time ***
 static volatile int readValue_ = 0;;
 static volatile NSecTime readTime_ = 0;
@@ -37,14 +110,68 @@ static volatile NSecTime readTime_ = 0;
 //*** flag to indicate that we are reading in data ***
 static volatile bool readingData_ = false;
 
+//*** power down - requested from any thread, done by the sampling thread after ***
+//*** its next conversion so SCK never goes high in the middle of a shift       ***
+static std::mutex powerMutex_;
+static std::atomic<bool> powerDownRequested_( false );
+static std::atomic<bool> poweredDown_( false );
+static std::atomic<int> discardSamples_( 0 );
+
+//*** raw sample capture (strftime path), and the file now open ***
+static std::string capturePath_;
+static std::string captureOpenPath_;
+static FILE *captureFp_ = NULL;
+
 
 //*****************
 //*** Functions ***
 //*****************
 
+//*** Interrupt Service Routine ***
+static void H_fallingEdgeISR();
+
+//*****************************************************************************
+//*****************************************************************************
+static void *H_edgeThread( void * )
+{
+NSecTime edges[EDGE_BATCH];
+NSecTime lastShiftEnd = 0;
+
+    H_applyRealtime();
+
+    while ( edgeThreadRunning_ )
+    {
+        //*** everything queued since the last read, in one go ***
+        int numEdges = GPIO_readEdges( lines_, edges, EDGE_BATCH,
+                                       poweredDown_ ? EDGE_IDLE_POLL_MS : EDGE_POLL_MS );
+        if ( numEdges < 0 ) break;
+        if ( numEdges == 0 ) continue;
+
+        //*** edges before the end of our last shift were data bits, not ready ***
+        NSecTime edge = edges[numEdges-1];
+        if ( edge <= lastShiftEnd ) continue;
+
+        H_shiftIn( edge );
+        lastShiftEnd = H_getNSecTime();
+    }
+
+    return NULL;
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
-void HX711_init( int DT_Pin, int SCK_Pin, int rawTare, double scale )
+void HX711_setBackend( HX711_Backend backend, const char *chipPath )
+{
+    backend_ = backend;
+
+    if ( chipPath != NULL ) chipPath_ = chipPath;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_init( int DT_Pin, int SCK_Pin, int rawTare, double scale )
 {
     //*** save initialization values ***
     DT_Pin_  = DT_Pin;
@@ -52,12 +179,140 @@ void HX711_init( int DT_Pin, int SCK_Pin, int rawTare, double scale )
     tare_    = rawTare;
     scale_   = scale;
 
+    calibratedTare_ = rawTare;
+
+    if ( backend_ == HX711_BACKEND_GPIO_CDEV )
+    {
+        //*** request lines, edges come with kernel timestamps ***
+        if ( !GPIO_requestLines( chipPath_.c_str(), DT_Pin_, SCK_Pin_, "hx711", lines_ ) ) return false;
+
+        edgeThreadRunning_ = true;
+        if ( pthread_create( &edgeThread_, NULL, H_edgeThread, NULL ) != 0 )
+        {
+            edgeThreadRunning_ = false;
+            GPIO_releaseLines( lines_ );
+            return false;
+        }
+
+        return true;
+    }
+
     //*** set up serial shift pins ***
     pinMode( DT_Pin_, INPUT );
     pinMode( SCK_Pin_, OUTPUT );
 
     //*** Set up interrupt Service Routine on falling edge of DT pin ***
-    wiringPiISR( DT_Pin_, INT_EDGE_FALLING, H_fallingEdgeISR );
+    return wiringPiISR( DT_Pin_, INT_EDGE_FALLING, H_fallingEdgeISR ) >= 0;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_setRealtime( const HX711_RtOptions &options )
+{
+    rtOptions_ = options;
+    rtApplied_ = false;
+
+    //*** process wide - keeps the sampling path free of page faults ***
+    if ( options.lockMemory && mlockall( MCL_CURRENT | MCL_FUTURE ) != 0 ) return false;
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_getRtStats( HX711_RtStats &stats )
+{
+    stats.numSamples        = numSamples_;
+    stats.numDeadlineMisses = numDeadlineMisses_;
+    stats.numLateStarts     = numLateStarts_;
+    stats.maxClockHigh      = maxClockHigh_;
+    stats.maxWakeLatency    = maxWakeLatency_;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void H_applyRealtime()
+{
+    rtApplied_ = true;
+
+    //*** pin to the (isolated) core ***
+    if ( rtOptions_.cpu >= 0 )
+    {
+        cpu_set_t cpus;
+        CPU_ZERO( &cpus );
+        CPU_SET( rtOptions_.cpu, &cpus );
+
+        if ( pthread_setaffinity_np( pthread_self(), sizeof(cpus), &cpus ) != 0 )
+        {
+            printf( "HX711: unable to pin sampling thread to CPU %d\n", rtOptions_.cpu );
+        }
+    }
+
+    //*** run ahead of Qt, SQLite and networking ***
+    if ( rtOptions_.priority > 0 )
+    {
+        struct sched_param param;
+        memset( &param, 0, sizeof(param) );
+        param.sched_priority = rtOptions_.priority;
+
+        if ( pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) != 0 )
+        {
+            printf( "HX711: unable to set SCHED_FIFO priority %d\n", rtOptions_.priority );
+        }
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_shutdown()
+{
+    if ( edgeThreadRunning_ )
+    {
+        edgeThreadRunning_ = false;
+        pthread_join( edgeThread_, NULL );
+    }
+
+    GPIO_releaseLines( lines_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_powerDown()
+{
+    std::lock_guard<std::mutex> lock( powerMutex_ );
+
+    if ( !poweredDown_ ) powerDownRequested_ = true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_powerUp()
+{
+    std::lock_guard<std::mutex> lock( powerMutex_ );
+
+    //*** not done yet - nothing to undo ***
+    powerDownRequested_ = false;
+
+    if ( !poweredDown_ ) return;
+
+    //*** SCK low wakes the chip (gain 128 again), its first conversions aren't settled ***
+    discardSamples_ = WAKE_DISCARD_SAMPLES;
+    H_writeSCK( LOW );
+    poweredDown_ = false;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_isPoweredDown()
+{
+    return poweredDown_ || powerDownRequested_;
 }
 
 
@@ -67,20 +322,32 @@ float HX711_getWeight()
 {
 int numSamplesCollected = 0;
 float weightVal = 0;
-NSecTime lastProcessed = 0;
+NSecTime lastProcessed;
 double total = 0;
-std::array<int,SAMPLES_PER_WEIGHT> data;
+std::array<int,MAX_SAMPLES_PER_WEIGHT> data;
+std::array<int,MAX_SAMPLES_PER_WEIGHT> raw;
+std::array<NSecTime,MAX_SAMPLES_PER_WEIGHT> times;
+const int numSamples = samplesPerWeight_;
+const int tare = tare_;
+
+    //*** wake on demand ***
+    HX711_powerUp();
 
+    //*** only conversions from now on - the last one may be from before a power down ***
+    lastProcessed = readTime_;
 
     //*** wait for # samples to be collected ***
-    while ( numSamplesCollected < SAMPLES_PER_WEIGHT ) 
+    while ( numSamplesCollected < numSamples ) 
     {
         //*** check if we have a new sample ***
         if ( readTime_ > lastProcessed )
         {
             //*** get data and update time ***
             lastProcessed = readTime_;
-            data[numSamplesCollected++] = -H_extendSign(readValue_);
+            raw[numSamplesCollected]   = readValue_;
+            times[numSamplesCollected] = lastProcessed;
+            data[numSamplesCollected]  = -H_extendSign( raw[numSamplesCollected] );
+            numSamplesCollected++;
         }
 
         //*** otherwise, wait a bit ***
@@ -91,45 +358,111 @@ std::array<int,SAMPLES_PER_WEIGHT> data;
         }
     }
     
-    //*** determine median value ***
-    int mid = SAMPLES_PER_WEIGHT / 2;
-    int median = ( data[mid] + data[mid-1] ) / 2;
-    int variant = median / 10;
-    
-//    for( int i=0; i<SAMPLES_PER_WEIGHT; i++ )
-//    {
-//        printf( "i: %d   data: %d\n", i, data[i] );
-//    }
-    
-//    printf( "median: %d  variant: %d\n", median, variant );
-    
-    //*** remove outliers ***
-    for ( int i=0; i<SAMPLES_PER_WEIGHT; i++ )
+    //*** remove outliers (shared with the replay tool) ***
+    int numOutliers = HX711_rejectOutliers( data.data(), numSamples );
+    if ( numOutliers > 0 )
     {
-        int diff = abs( data[i] - median );
-        if ( diff > abs(variant) ) 
-        {
-            data[i] = median;
-            printf( "diff: %d  variant: %d *\n", diff, variant );
-        }
+        printf( "outliers: %d of %d *\n", numOutliers, numSamples );
     }
     
     //*** calculate weight average ***
-    for ( int i=0; i<SAMPLES_PER_WEIGHT; i++ )
+    for ( int i=0; i<numSamples; i++ )
     {
-        total += ( ((double)data[i] - (double)tare_) * scale_ );
+        total += ( ((double)data[i] - (double)tare) * scale_ );
     }
         
     //*** compute the average weight ***
-    weightVal = (float)( total / (double)SAMPLES_PER_WEIGHT );
+    weightVal = (float)( total / (double)numSamples );
+
+    //*** let auto zero follow drift of the empty platform ***
+    if ( autoZero_.enabled )
+    {
+        auto range = std::minmax_element( data.begin(), data.begin() + numSamples );
+        H_trackZero( ( total / scale_ / (double)numSamples ) + (double)tare, *range.second - *range.first );
+    }
     
     //*** bound by 0 ***
     if ( weightVal < 0 ) weightVal = 0;
 
+    H_captureWeight( raw.data(), times.data(), numSamples, tare, weightVal );
+
     return weightVal;
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+void HX711_setCapture( const char *path )
+{
+    if ( captureFp_ != NULL ) fclose( captureFp_ );
+    captureFp_ = NULL;
+    captureOpenPath_.clear();
+
+    //*** file is opened with the first weight ***
+    capturePath_ = ( path != NULL ) ? path : "";
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void H_captureWeight( const int *raw, const NSecTime *times, int numSamples, int tare, float weight )
+{
+HX711_CaptureRecord rec;
+HX711_CaptureSample samples[MAX_SAMPLES_PER_WEIGHT];
+char path[PATH_MAX];
+struct tm tmNow;
+int rtn = 0;
+
+    if ( capturePath_.empty() ) return;
+
+    NSecTime now = H_getNSecTime();
+
+    //*** path may name the day - a new file when it changes ***
+    time_t secs = (time_t)( now / NSecsPerSec );
+    localtime_r( &secs, &tmNow );
+    if ( strftime( path, sizeof(path), capturePath_.c_str(), &tmNow ) == 0 ) return;
+
+    if ( captureOpenPath_ != path )
+    {
+        if ( captureFp_ != NULL ) fclose( captureFp_ );
+
+        //*** only tried again on the next file ***
+        captureOpenPath_ = path;
+        captureFp_ = fopen( path, "ab" );
+
+        if ( captureFp_ == NULL ) printf( "HX711: unable to open capture file %s\n", path );
+    }
+
+    if ( captureFp_ == NULL ) return;
+
+    rec.magic      = HX711_CAPTURE_MAGIC;
+    rec.numSamples = (uint16_t)numSamples;
+    rec.reserved   = 0;
+    rec.tare       = tare;
+    rec.weight     = weight;
+    rec.scale      = scale_;
+    rec.time       = now;
+
+    for ( int i=0; i<numSamples; i++ )
+    {
+        samples[i].raw      = (uint32_t)raw[i] & 0x00FFFFFF;
+        samples[i].offsetUs = (uint32_t)( ( times[i] - times[0] ) / ( NSecsPerSec / USecsPerSec ) );
+    }
+
+    //*** one weight per flush - a power cut loses at most this record ***
+    rtn |= fwrite( &rec, sizeof(rec), 1, captureFp_ ) != 1;
+    rtn |= fwrite( samples, sizeof(samples[0]), numSamples, captureFp_ ) != (size_t)numSamples;
+    rtn |= fflush( captureFp_ ) != 0;
+
+    if ( rtn != 0 )
+    {
+        printf( "HX711: capture write failed, stopping capture to %s\n", path );
+        fclose( captureFp_ );
+        captureFp_ = NULL;
+    }
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
 int HX711_getRawReading()
@@ -144,9 +477,179 @@ void HX711_setCalibrationData( int tareVal, int weightVal, float actualWeight )
 {
     //*** save new raw tare value ***
     tare_ = tareVal;
+    calibratedTare_ = tareVal;
+
+    //*** new calibration - drift history starts over ***
+    numAdjustments_ = 0;
+    numLimited_     = 0;
+    lastAdjustTime_ = 0;
 
     //*** calculate scale factor ***
     scale_ = (double)( actualWeight / ((double)weightVal - (double)tareVal) );
+
+    //*** keep reference points for the profile ***
+    refTareRaw_      = tareVal;
+    refWeightRaw_    = weightVal;
+    refWeight_       = actualWeight;
+    calibrationTime_ = H_getNSecTime();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_saveCalibration( const char *path, const char *cellId )
+{
+std::string tmpPath = std::string( path ) + ".tmp";
+FILE *fp = NULL;
+int rtn = 0;
+
+    //*** write to a temp file first ***
+    fp = fopen( tmpPath.c_str(), "w" );
+    if ( fp == NULL ) return false;
+
+    rtn |= fprintf( fp, "# HX711 calibration\n" ) < 0;
+    rtn |= fprintf( fp, "cell=%.*s\n", HX711_CELL_ID_MAX, cellId ) < 0;
+    rtn |= fprintf( fp, "tare=%d\n", calibratedTare_ ) < 0;
+    rtn |= fprintf( fp, "scale=%.17g\n", scale_ ) < 0;
+    rtn |= fprintf( fp, "timestamp=%lld\n", calibrationTime_ ) < 0;
+    rtn |= fprintf( fp, "refTareRaw=%d\n", refTareRaw_ ) < 0;
+    rtn |= fprintf( fp, "refWeightRaw=%d\n", refWeightRaw_ ) < 0;
+    rtn |= fprintf( fp, "refWeight=%.9g\n", refWeight_ ) < 0;
+
+    //*** make sure it is on disk before it replaces the old one ***
+    rtn |= fflush( fp ) != 0;
+    rtn |= fsync( fileno( fp ) ) != 0;
+    rtn |= fclose( fp ) != 0;
+
+    if ( rtn != 0 || rename( tmpPath.c_str(), path ) != 0 )
+    {
+        unlink( tmpPath.c_str() );
+        return false;
+    }
+
+    //*** sync the directory so the rename survives power loss ***
+    std::string dirPath = path;
+    int dirFd = open( dirname( &dirPath[0] ), O_RDONLY );
+    if ( dirFd >= 0 )
+    {
+        fsync( dirFd );
+        close( dirFd );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_loadCalibration( const char *path, const char *cellId, HX711_Calibration &cal )
+{
+FILE *fp = NULL;
+char line[128];
+int numFields = 0;
+
+    memset( &cal, 0, sizeof(cal) );
+
+    fp = fopen( path, "r" );
+    if ( fp == NULL ) return false;
+
+    while ( fgets( line, sizeof(line), fp ) != NULL )
+    {
+        //*** split key=value, strip newline ***
+        char *val = strchr( line, '=' );
+        if ( line[0] == '#' || val == NULL ) continue;
+        *val++ = 0;
+        val[strcspn( val, "\r\n" )] = 0;
+
+        if ( strcmp( line, "cell" ) == 0 )
+        {
+            strncpy( cal.cellId, val, HX711_CELL_ID_MAX );
+            numFields++;
+        }
+        else if ( strcmp( line, "tare" ) == 0 )         { cal.tare = atoi( val );            numFields++; }
+        else if ( strcmp( line, "scale" ) == 0 )        { cal.scale = strtod( val, NULL );   numFields++; }
+        else if ( strcmp( line, "timestamp" ) == 0 )    cal.timestamp = atoll( val );
+        else if ( strcmp( line, "refTareRaw" ) == 0 )   cal.refTareRaw = atoi( val );
+        else if ( strcmp( line, "refWeightRaw" ) == 0 ) cal.refWeightRaw = atoi( val );
+        else if ( strcmp( line, "refWeight" ) == 0 )    cal.refWeight = strtof( val, NULL );
+    }
+
+    fclose( fp );
+
+    //*** cell, tare and scale are required, and it must be this cell's profile ***
+    if ( numFields != 3 || cal.scale == 0.0 ) return false;
+    if ( cellId != NULL && strcmp( cal.cellId, cellId ) != 0 ) return false;
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_initFromProfile( int DT_Pin, int SCK_Pin, const char *path, const char *cellId,
+                            int defaultTare, double defaultScale )
+{
+HX711_Calibration cal;
+
+    if ( !HX711_loadCalibration( path, cellId, cal ) )
+    {
+        HX711_init( DT_Pin, SCK_Pin, defaultTare, defaultScale );
+        return false;
+    }
+
+    HX711_init( DT_Pin, SCK_Pin, cal.tare, cal.scale );
+
+    //*** restore reference points so a re-save keeps them ***
+    refTareRaw_      = cal.refTareRaw;
+    refWeightRaw_    = cal.refWeightRaw;
+    refWeight_       = cal.refWeight;
+    calibrationTime_ = cal.timestamp;
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+HX711_TareResult HX711_verifyTare( int numSamples, int tolerance, int timeoutMs )
+{
+int numSamplesCollected = 0;
+NSecTime lastProcessed = readTime_;
+NSecTime deadline = H_getNSecTime() + (NSecTime)timeoutMs * ( NSecsPerSec / 1000 );
+long long total = 0;
+
+    //*** wake on demand ***
+    HX711_powerUp();
+
+    //*** collect a handful of new conversions ***
+    while ( numSamplesCollected < numSamples )
+    {
+        if ( readTime_ > lastProcessed )
+        {
+            lastProcessed = readTime_;
+            total += -H_extendSign( readValue_ );
+            numSamplesCollected++;
+        }
+        else if ( H_getNSecTime() > deadline )
+        {
+            return HX711_TARE_TIMEOUT;
+        }
+        else
+        {
+            delay( 1 );
+        }
+    }
+
+    int avg = (int)( total / numSamples );
+
+    //*** something on the platform (or the cell moved a lot) ***
+    if ( abs( avg - tare_ ) > tolerance ) return HX711_TARE_LOADED;
+
+    //*** empty - start from a fresh zero ***
+    tare_ = avg;
+    calibratedTare_ = avg;
+
+    return HX711_TARE_OK;
 }
 
 
@@ -159,21 +662,92 @@ void HX711_getCalibrationData( int &rawTareValue, double &scaleValue )
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+void HX711_setAutoZero( const HX711_AutoZero &settings )
+{
+    autoZero_ = settings;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_getAutoZero( HX711_AutoZero &settings )
+{
+    settings = autoZero_;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_getDriftReport( HX711_DriftReport &report )
+{
+    report.calibratedTare = calibratedTare_;
+    report.currentTare    = tare_;
+    report.totalDrift     = tare_ - calibratedTare_;
+    report.numAdjustments = numAdjustments_;
+    report.numLimited     = numLimited_;
+    report.lastAdjustTime = lastAdjustTime_;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void HX711_setSamplesPerWeight( int numSamples )
+{
+    //*** median needs at least two samples ***
+    if ( numSamples < 2 ) numSamples = 2;
+    if ( numSamples > MAX_SAMPLES_PER_WEIGHT ) numSamples = MAX_SAMPLES_PER_WEIGHT;
+
+    samplesPerWeight_ = numSamples;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+int HX711_getSamplesPerWeight()
+{
+    return samplesPerWeight_;
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
 static void H_fallingEdgeISR()
+{
+    //*** first call - this is wiringPi's ISR thread, make it real time ***
+    if ( !rtApplied_ ) H_applyRealtime();
+
+    //*** no kernel timestamp, time taken when the read completes ***
+    H_shiftIn( 0 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void H_shiftIn( NSecTime edgeTime )
 {
 int i = 0;
 int tempReadValue = 0;
 const int NUM_BITS = 24;    // 24 bit A/D converter
+NSecTime clockHigh = 0;
+NSecTime maxHigh = 0;
 
     //*** make sure we are valid to read ***
     //*** reading flag should be reset and DT oin should be low ***
-    if ( readingData_ || digitalRead( DT_Pin_ ) == 1 ) return;
+    if ( readingData_ || H_readDT() == 1 ) return;
     
     //*** set reading flag ***
     readingData_ = true;
 
+    //*** how long since the chip signalled ready ***
+    if ( edgeTime != 0 )
+    {
+        NSecTime latency = H_getNSecTime() - edgeTime;
+        if ( latency > maxWakeLatency_ ) maxWakeLatency_ = latency;
+        if ( latency > MAX_WAKE_LATENCY_NS ) numLateStarts_++;
+    }
+
     //*** need delay before reading data ***
     H_pulseDelay();
 
@@ -181,7 +755,8 @@ const int NUM_BITS = 24;    // 24 bit A/D converter
     for ( i=0; i<NUM_BITS; i++ )
     {
         //*** bring clock high ***
-        digitalWrite( SCK_Pin_, HIGH );
+        H_writeSCK( HIGH );
+        clockHigh = H_getNSecTime();
 
         //*** shift current value to make room for bit ***
         tempReadValue <<= 1;
@@ -190,10 +765,12 @@ const int NUM_BITS = 24;    // 24 bit A/D converter
         H_pulseDelay();
 
         //*** bring clock low ***
-        digitalWrite( SCK_Pin_, LOW );
+        H_writeSCK( LOW );
+        clockHigh = H_getNSecTime() - clockHigh;
+        if ( clockHigh > maxHigh ) maxHigh = clockHigh;
 
         //*** if HIGH, add the bit to the value ***
-        if ( digitalRead( DT_Pin_ ) ) 
+        if ( H_readDT() ) 
         {
             tempReadValue |= 0x0001;
 //            printf("1");
@@ -205,22 +782,75 @@ const int NUM_BITS = 24;    // 24 bit A/D converter
     }
 //    printf("\n" );
     
-    //*** have all bits, save the data and time ***
-    readValue_ = tempReadValue;
-    readTime_ = H_getNSecTime();
+    numSamples_++;
+    if ( maxHigh > maxClockHigh_ ) maxClockHigh_ = maxHigh;
+
+    //*** clock was held high long enough to power down - data is corrupt ***
+    if ( maxHigh > MAX_CLOCK_HIGH_NS )
+    {
+        numDeadlineMisses_++;
+    }
+    //*** still settling after a power up ***
+    else if ( discardSamples_ > 0 )
+    {
+        discardSamples_--;
+    }
+    else
+    {
+        //*** have all bits, save the data and time ***
+        readValue_ = tempReadValue;
+        readTime_ = ( edgeTime != 0 ) ? edgeTime : H_getNSecTime();
+    }
 
     //*** need one more pulse to indicate a gain of 128 ***
     //*** 2 pulses = gain of 32, 3 pulses = gain of 64  ***
     H_pulseDelay();
-    digitalWrite( SCK_Pin_, HIGH );
+    H_writeSCK( HIGH );
     H_pulseDelay();
-    digitalWrite( SCK_Pin_, LOW );
+
+    //*** power down wanted - leave SCK high (60 us and the chip is off) ***
+    if ( powerDownRequested_ )
+    {
+        std::lock_guard<std::mutex> lock( powerMutex_ );
+
+        if ( powerDownRequested_ )
+        {
+            powerDownRequested_ = false;
+            poweredDown_ = true;
+        }
+    }
+
+    if ( !poweredDown_ ) H_writeSCK( LOW );
 
     //*** reset flag ***
     readingData_ = false;
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+int H_readDT()
+{
+    if ( backend_ == HX711_BACKEND_GPIO_CDEV ) return GPIO_getDT( lines_ );
+
+    return digitalRead( DT_Pin_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+void H_writeSCK( int val )
+{
+    if ( backend_ == HX711_BACKEND_GPIO_CDEV )
+    {
+        GPIO_setSCK( lines_, val );
+        return;
+    }
+
+    digitalWrite( SCK_Pin_, val );
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
 void H_pulseDelay()
@@ -260,6 +890,43 @@ NSecTime retTime = 0;
 }
 
 
+//*****************************************************************************
+//*****************************************************************************
+void H_trackZero( double avgRaw, int spread )
+{
+    //*** no calibration yet ***
+    if ( scale_ == 0.0 ) return;
+
+    //*** only while the platform is empty ... ***
+    if ( fabs( (avgRaw - (double)tare_) * scale_ ) > autoZero_.zeroBand ) return;
+
+    //*** ... and settled ***
+    if ( spread > autoZero_.stableBand ) return;
+
+    //*** rate limit ***
+    NSecTime now = H_getNSecTime();
+    if ( lastAdjustTime_ != 0 &&
+         now - lastAdjustTime_ < (NSecTime)autoZero_.minIntervalMs * ( NSecsPerSec / 1000 ) ) return;
+
+    //*** move toward the reading, at most maxStep ***
+    int step = (int)lround( avgRaw ) - tare_;
+    if ( step > autoZero_.maxStep ) step = autoZero_.maxStep;
+    if ( step < -autoZero_.maxStep ) step = -autoZero_.maxStep;
+    if ( step == 0 ) return;
+
+    //*** too far from calibration - needs a real re-tare ***
+    if ( abs( tare_ + step - calibratedTare_ ) > autoZero_.maxTotalDrift )
+    {
+        numLimited_++;
+        return;
+    }
+
+    tare_ += step;
+    numAdjustments_++;
+    lastAdjustTime_ = now;
+}
+
+
 //*****************************************************************************
 //*****************************************************************************
 int H_extendSign( int val )
@@ -6,12 +6,92 @@
     //****************
    typedef long long NSecTime;
 
+   //*** auto zero tracking settings ***
+   typedef struct
+   {
+      bool   enabled;
+      double zeroBand;        // weights within +/- this are treated as an empty platform
+      int    stableBand;      // max raw spread of a weight's samples to count as stable
+      int    maxStep;         // max raw change of the tare per adjustment
+      int    minIntervalMs;   // min time between adjustments
+      int    maxTotalDrift;   // max raw distance from the calibrated tare
+   } HX711_AutoZero;
+
+   //*** drift since calibration ***
+   typedef struct
+   {
+      int      calibratedTare;   // tare from init / calibration
+      int      currentTare;      // tare now in use
+      int      totalDrift;       // currentTare - calibratedTare
+      int      numAdjustments;   // adjustments made
+      int      numLimited;       // adjustments refused by maxTotalDrift
+      NSecTime lastAdjustTime;   // time of last adjustment (0 if none)
+   } HX711_DriftReport;
+
+   //*** persisted calibration profile for one load cell ***
+   const int HX711_CELL_ID_MAX = 31;
+
+   typedef struct
+   {
+      char     cellId[HX711_CELL_ID_MAX+1];
+      int      tare;            // raw tare
+      double   scale;           // scale factor
+      NSecTime timestamp;       // when calibrated
+      int      refTareRaw;      // raw reading, empty platform
+      int      refWeightRaw;    // raw reading with the reference weight
+      float    refWeight;       // reference weight
+   } HX711_Calibration;
+
+   //*** real time options for the sampling thread ***
+   typedef struct
+   {
+      int  priority;       // SCHED_FIFO priority 1..99, 0 leaves normal scheduling
+      int  cpu;            // CPU to pin the sampling thread to, -1 for any
+      bool lockMemory;     // mlockall - no page faults in the sampling path
+   } HX711_RtOptions;
+
+   //*** sampling thread timing ***
+   typedef struct
+   {
+      long long numSamples;         // samples read
+      long long numDeadlineMisses;  // SCK held high too long - sample discarded
+      long long numLateStarts;      // shift started late after the ready edge
+      NSecTime  maxClockHigh;       // longest SCK high time
+      NSecTime  maxWakeLatency;     // longest ready edge to shift start (GPIO_CDEV)
+   } HX711_RtStats;
+
+   //*** GPIO access ***
+   enum HX711_Backend
+   {
+      HX711_BACKEND_WIRINGPI,   // wiringPi pins and ISR thread
+      HX711_BACKEND_GPIO_CDEV   // Linux GPIO character device, kernel timestamped edges
+   };
+
+   //*** result of HX711_verifyTare ***
+   enum HX711_TareResult
+   {
+      HX711_TARE_OK,            // platform empty, tare refreshed
+      HX711_TARE_LOADED,        // reading too far from tare, stored tare kept
+      HX711_TARE_TIMEOUT        // no conversions from the chip
+   };
+
 
    //************************
    //*** Public Functions ***
    //************************
 
-   void  HX711_init( int DT_Pin, int SC_Pin, int rawTare, double scale );
+   //*** selects the GPIO backend, call before init (pins are line offsets for GPIO_CDEV) ***
+   void  HX711_setBackend( HX711_Backend backend, const char *chipPath );
+
+   bool  HX711_init( int DT_Pin, int SC_Pin, int rawTare, double scale );
+
+   //*** real time sampling - call before init ***
+   bool  HX711_setRealtime( const HX711_RtOptions &options );
+
+   void  HX711_getRtStats( HX711_RtStats &stats );
+
+   //*** stops edge handling and releases the lines (GPIO_CDEV) ***
+   void  HX711_shutdown();
 
    float HX711_getWeight();
 
@@ -21,6 +101,43 @@
 
    void  HX711_getCalibrationData( int &rawTareValue, double &scaleValue );
 
+   //*** calibration profiles - saved atomically, one file per load cell ***
+   bool  HX711_saveCalibration( const char *path, const char *cellId );
+
+   bool  HX711_loadCalibration( const char *path, const char *cellId, HX711_Calibration &cal );
+
+   //*** init using a saved profile, or the defaults if there isn't a valid one ***
+   bool  HX711_initFromProfile( int DT_Pin, int SC_Pin, const char *path, const char *cellId,
+                                int defaultTare, double defaultScale );
+
+   //*** warm start - checks the tare against a few conversions ***
+   HX711_TareResult HX711_verifyTare( int numSamples, int tolerance, int timeoutMs );
+
+   //*** auto zero - tracks the tare while the platform is empty and stable ***
+   void  HX711_setAutoZero( const HX711_AutoZero &settings );
+
+   void  HX711_getAutoZero( HX711_AutoZero &settings );
+
+   void  HX711_getDriftReport( HX711_DriftReport &report );
+
+   //*** filter window - samples averaged per weight (2..64, default 8) ***
+   void  HX711_setSamplesPerWeight( int numSamples );
+
+   int   HX711_getSamplesPerWeight();
+
+   //*** idle power down - SCK is held high after the next conversion (any thread) ***
+   void  HX711_powerDown();
+
+   //*** powers back up, the settling conversions are discarded (any thread) ***
+   //*** getWeight and verifyTare power up on their own                      ***
+   void  HX711_powerUp();
+
+   bool  HX711_isPoweredDown();
+
+   //*** raw sample capture - every weight and its samples are appended to path (strftime ***
+   //*** fields allowed, e.g. raw-%Y%m%d.hxc), NULL or empty stops. Call before sampling. ***
+   void  HX711_setCapture( const char *path );
+
 
    //***********************
    //*** local functions ***
@@ -32,8 +149,17 @@
 
    int H_extendSign( int val );
 
-   //*** Interrupt Service Routine ***
-   static void H_fallingEdgeISR();
+   void H_shiftIn( NSecTime edgeTime );
+
+   void H_applyRealtime();
+
+   int  H_readDT();
+
+   void H_writeSCK( int val );
+
+   void H_trackZero( double avgRaw, int spread );
+
+   void H_captureWeight( const int *raw, const NSecTime *times, int numSamples, int tare, float weight );
 
 
 #endif
@@ -0,0 +1,112 @@
+#include "HX711Raw.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//*****************
+//*** CONSTANTS ***
+//*****************
+
+//*** file is read in blocks of this size ***
+const size_t CAPTURE_READ_SIZE = 1024 * 1024;
+
+
+//*****************
+//*** Functions ***
+//*****************
+
+//*****************************************************************************
+//*****************************************************************************
+int HX711_rejectOutliers( int *data, int numSamples )
+{
+int numReplaced = 0;
+
+    //*** determine median value ***
+    int mid = numSamples / 2;
+    int median = ( data[mid] + data[mid-1] ) / 2;
+    int variant = median / 10;
+
+    //*** remove outliers ***
+    for ( int i=0; i<numSamples; i++ )
+    {
+        int diff = abs( data[i] - median );
+        if ( diff > abs(variant) )
+        {
+            data[i] = median;
+            numReplaced++;
+        }
+    }
+
+    return numReplaced;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+bool HX711_readCapture( const char *path, HX711_Capture &capture )
+{
+FILE *fp = NULL;
+std::vector<char> buf;
+size_t have = 0;
+size_t pos = 0;
+bool atEnd = false;
+HX711_CaptureRecord rec;
+
+    capture.records.clear();
+    capture.sampleIndex.clear();
+    capture.samples.clear();
+    capture.numSkipped = 0;
+
+    fp = fopen( path, "rb" );
+    if ( fp == NULL ) return false;
+
+    while ( true )
+    {
+        //*** keep at least one whole record in the buffer ***
+        size_t need = sizeof(rec) + HX711_CAPTURE_MAX_SAMPLES * sizeof(HX711_CaptureSample);
+        if ( !atEnd && have - pos < need )
+        {
+            buf.erase( buf.begin(), buf.begin() + pos );
+            have -= pos;
+            pos = 0;
+
+            buf.resize( have + CAPTURE_READ_SIZE );
+            size_t numRead = fread( &buf[have], 1, CAPTURE_READ_SIZE, fp );
+            have += numRead;
+            atEnd = ( numRead < CAPTURE_READ_SIZE );
+        }
+
+        if ( have - pos < sizeof(rec) ) break;
+
+        memcpy( &rec, &buf[pos], sizeof(rec) );
+
+        size_t size = sizeof(rec) + rec.numSamples * sizeof(HX711_CaptureSample);
+
+        //*** not a record (or cut short) - step forward to the next magic ***
+        if ( rec.magic != HX711_CAPTURE_MAGIC || rec.numSamples == 0 ||
+             rec.numSamples > HX711_CAPTURE_MAX_SAMPLES || have - pos < size )
+        {
+            pos++;
+            capture.numSkipped++;
+            continue;
+        }
+
+        capture.records.push_back( rec );
+        capture.sampleIndex.push_back( (uint32_t)capture.samples.size() );
+
+        //*** copied - after a resync the samples needn't be aligned ***
+        size_t first = capture.samples.size();
+        capture.samples.resize( first + rec.numSamples );
+        memcpy( &capture.samples[first], &buf[pos + sizeof(rec)], rec.numSamples * sizeof(HX711_CaptureSample) );
+
+        pos += size;
+    }
+
+    //*** torn tail ***
+    capture.numSkipped += have - pos;
+
+    fclose( fp );
+
+    return true;
+}
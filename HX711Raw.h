@@ -0,0 +1,58 @@
+#ifndef HX711RAW_H
+#define HX711RAW_H
+
+#include <stdint.h>
+#include <vector>
+
+    //***********************************************************************
+    //*** raw sample capture - a record per weight, followed by its       ***
+    //*** samples. Little endian, records are appended and can be read    ***
+    //*** back without the HX711 (hx711replay).                           ***
+    //***********************************************************************
+   const uint32_t HX711_CAPTURE_MAGIC = 0x31435848;   // "HXC1"
+
+   //*** most samples a record can hold (the filter window is at most 64) ***
+   const int HX711_CAPTURE_MAX_SAMPLES = 1024;
+
+   typedef struct
+   {
+      uint32_t magic;         // HX711_CAPTURE_MAGIC, finds the next record after a torn write
+      uint16_t numSamples;
+      uint16_t reserved;
+      int32_t  tare;          // raw tare in use
+      float    weight;        // weight reported
+      double   scale;         // scale factor in use
+      int64_t  time;          // first sample, ns since the epoch
+   } HX711_CaptureRecord;
+
+   typedef struct
+   {
+      uint32_t raw;           // 24 bits as shifted in, not sign extended
+      uint32_t offsetUs;      // since the record's first sample
+   } HX711_CaptureSample;
+
+   static_assert( sizeof(HX711_CaptureRecord) == 32, "HX711_CaptureRecord layout" );
+   static_assert( sizeof(HX711_CaptureSample) == 8, "HX711_CaptureSample layout" );
+
+   //*** a capture file, samples of record i start at sampleIndex[i] ***
+   typedef struct
+   {
+      std::vector<HX711_CaptureRecord> records;
+      std::vector<uint32_t>            sampleIndex;
+      std::vector<HX711_CaptureSample> samples;
+      long long                        numSkipped;      // bytes that weren't a whole record
+   } HX711_Capture;
+
+
+   //************************
+   //*** Public Functions ***
+   //************************
+
+   //*** median filter - samples too far from the median are replaced by it, returns the number replaced ***
+   int   HX711_rejectOutliers( int *data, int numSamples );
+
+   //*** reads a whole capture file ***
+   bool  HX711_readCapture( const char *path, HX711_Capture &capture );
+
+
+#endif
@@ -0,0 +1,153 @@
+#include "LivePublisher.h"
+#include "FpMessages.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LivePublisher::LivePublisher
+ */
+//*****************************************************************************
+LivePublisher::LivePublisher()
+{
+    fd_            = -1;
+    seq_           = 0;
+    lastValue_     = 0;
+    lastKey_       = 0;
+    sinceKeyframe_ = LIVE_KEYFRAME_INTERVAL;
+
+    memset( &dest_, 0, sizeof(dest_) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LivePublisher::~LivePublisher
+ */
+//*****************************************************************************
+LivePublisher::~LivePublisher()
+{
+    if ( fd_ >= 0 ) close( fd_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LivePublisher::open
+ * @param group
+ * @param port
+ * @param ttl
+ * @param iface
+ * @return
+ */
+//*****************************************************************************
+bool LivePublisher::open( const std::string &group, uint16_t port, int ttl, const std::string &iface )
+{
+unsigned char mcTtl = ttl;
+unsigned char loop  = 1;
+struct in_addr local;
+
+    dest_.sin_family = AF_INET;
+    dest_.sin_port   = htons( port );
+
+    if ( inet_pton( AF_INET, group.c_str(), &dest_.sin_addr ) != 1 )
+    {
+        printf( "LivePublisher: bad group address %s\n", group.c_str() );
+        return false;
+    }
+
+    //*** non-blocking - a frame is dropped rather than delay the loop ***
+    fd_ = socket( AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( fd_ < 0 )
+    {
+        printf( "LivePublisher: socket failed: %s\n", strerror( errno ) );
+        return false;
+    }
+
+    setsockopt( fd_, IPPROTO_IP, IP_MULTICAST_TTL, &mcTtl, sizeof(mcTtl) );
+    setsockopt( fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop) );
+
+    if ( !iface.empty() )
+    {
+        if ( inet_pton( AF_INET, iface.c_str(), &local ) != 1 ||
+             setsockopt( fd_, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local) ) < 0 )
+        {
+            printf( "LivePublisher: can't send from %s\n", iface.c_str() );
+
+            //*** publish() does nothing without a socket ***
+            close( fd_ );
+            fd_ = -1;
+            return false;
+        }
+    }
+
+    printf( "LivePublisher: sending to %s:%d\n", group.c_str(), port );
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LivePublisher::publish
+ * @param weight
+ * @param key
+ */
+//*****************************************************************************
+void LivePublisher::publish( float weight, int32_t key )
+{
+t_LiveKeyframe keyframe;
+t_LiveDelta    delta;
+const void    *frame;
+size_t         size;
+
+    if ( fd_ < 0 ) return;
+
+    int32_t value = (int32_t)lround( weight * 100.0 );
+    int32_t diff  = value - lastValue_;
+
+    if ( sinceKeyframe_ >= LIVE_KEYFRAME_INTERVAL || key != lastKey_ || diff < INT16_MIN || diff > INT16_MAX )
+    {
+        memset( &keyframe, 0, sizeof(keyframe) );
+        keyframe.hdr.magic = LIVE_MAGIC;
+        keyframe.hdr.type  = LIVE_KEYFRAME;
+        keyframe.hdr.seq   = seq_;
+        keyframe.value     = value;
+        keyframe.key       = key;
+
+        frame = &keyframe;
+        size  = sizeof(keyframe);
+
+        sinceKeyframe_ = 0;
+    }
+    else
+    {
+        memset( &delta, 0, sizeof(delta) );
+        delta.hdr.magic = LIVE_MAGIC;
+        delta.hdr.type  = LIVE_DELTA;
+        delta.hdr.seq   = seq_;
+        delta.delta     = (int16_t)diff;
+
+        frame = &delta;
+        size  = sizeof(delta);
+    }
+
+    seq_++;
+    sinceKeyframe_++;
+    lastValue_ = value;
+    lastKey_   = key;
+
+    //*** lost frames are covered by the next keyframe ***
+    sendto( fd_, frame, size, MSG_DONTWAIT, (struct sockaddr *)&dest_, sizeof(dest_) );
+}
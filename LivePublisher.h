@@ -0,0 +1,49 @@
+#ifndef LIVEPUBLISHER_H
+#define LIVEPUBLISHER_H
+
+#include <stdint.h>
+#include <string>
+#include <netinet/in.h>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The LivePublisher class
+ *
+ * Multicasts the live weight as small delta frames with sequence numbers. A
+ * keyframe goes out every LIVE_KEYFRAME_INTERVAL frames, when the family
+ * changes, or when the change won't fit in a delta. The scale does the same
+ * work however many viewers there are.
+ */
+//*****************************************************************************
+class LivePublisher
+{
+public:
+
+    //*** constructor ***
+    LivePublisher();
+
+    //*** destructor ***
+    ~LivePublisher();
+
+    //*** opens the send socket - iface is the local address to send from, empty for default ***
+    bool open( const std::string &group, uint16_t port, int ttl, const std::string &iface );
+
+    //*** sends one frame ***
+    void publish( float weight, int32_t key );
+
+private:
+
+    int fd_;
+
+    struct sockaddr_in dest_;
+
+    //*** delta state ***
+    uint32_t seq_;
+    int32_t  lastValue_;
+    int32_t  lastKey_;
+    int      sinceKeyframe_;
+};
+
+#endif // LIVEPUBLISHER_H
@@ -0,0 +1,125 @@
+#include "LiveWeightReceiver.h"
+#include "FpMessages.h"
+
+#include <QUdpSocket>
+#include <QNetworkDatagram>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LiveWeightReceiver::LiveWeightReceiver
+ * @param parent
+ */
+//*****************************************************************************
+LiveWeightReceiver::LiveWeightReceiver( QObject *parent ) : QObject(parent)
+{
+    sock_    = new QUdpSocket( this );
+    synced_  = false;
+    nextSeq_ = 0;
+    value_   = 0;
+    key_     = 0;
+
+    connect( sock_, SIGNAL(readyRead()), SLOT(handleDatagrams()) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LiveWeightReceiver::start
+ * @param group
+ * @param port
+ * @return
+ */
+//*****************************************************************************
+bool LiveWeightReceiver::start( QString group, quint16 port )
+{
+    stop();
+
+    group_.setAddress( group );
+
+    if ( !sock_->bind( QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint ) )
+    {
+        return false;
+    }
+
+    return sock_->joinMulticastGroup( group_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LiveWeightReceiver::stop
+ */
+//*****************************************************************************
+void LiveWeightReceiver::stop()
+{
+    if ( sock_->state() == QAbstractSocket::BoundState )
+    {
+        sock_->leaveMulticastGroup( group_ );
+        sock_->close();
+    }
+
+    synced_ = false;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief LiveWeightReceiver::handleDatagrams
+ */
+//*****************************************************************************
+void LiveWeightReceiver::handleDatagrams()
+{
+t_LiveHeader   hdr;
+t_LiveKeyframe keyframe;
+t_LiveDelta    delta;
+bool           updated = false;
+
+    while ( sock_->hasPendingDatagrams() )
+    {
+        QByteArray msg = sock_->receiveDatagram().data();
+
+        if ( msg.size() < (int)sizeof(hdr) ) continue;
+
+        memcpy( &hdr, msg.constData(), sizeof(hdr) );
+        if ( hdr.magic != LIVE_MAGIC ) continue;
+
+        if ( hdr.type == LIVE_KEYFRAME && msg.size() == (int)sizeof(keyframe) )
+        {
+            memcpy( &keyframe, msg.constData(), sizeof(keyframe) );
+
+            value_  = keyframe.value;
+            key_    = keyframe.key;
+            synced_ = true;
+        }
+        else if ( hdr.type == LIVE_DELTA && msg.size() == (int)sizeof(delta) )
+        {
+            //*** a frame was lost - wait for the next keyframe ***
+            if ( !synced_ || hdr.seq != nextSeq_ )
+            {
+                synced_ = false;
+                continue;
+            }
+
+            memcpy( &delta, msg.constData(), sizeof(delta) );
+            value_ += delta.delta;
+        }
+        else
+        {
+            continue;
+        }
+
+        nextSeq_ = hdr.seq + 1;
+        updated  = true;
+    }
+
+    //*** only the latest reading matters ***
+    if ( updated && synced_ )
+    {
+        emit liveWeight( value_ / 100.0f, key_ );
+    }
+}
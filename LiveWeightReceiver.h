@@ -0,0 +1,56 @@
+#ifndef LIVEWEIGHTRECEIVER_H
+#define LIVEWEIGHTRECEIVER_H
+
+#include <QObject>
+#include <QHostAddress>
+
+class QUdpSocket;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The LiveWeightReceiver class
+ *
+ * Joins the scale's live weight multicast group and rebuilds the weight from
+ * keyframes and deltas. After a lost frame nothing is reported until the next
+ * keyframe.
+ */
+//*****************************************************************************
+class LiveWeightReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor ***
+    explicit LiveWeightReceiver( QObject *parent = nullptr );
+
+    //*** joins the group, stops any previous one ***
+    bool start( QString group, quint16 port );
+
+    //*** leaves the group ***
+    void stop();
+
+signals:
+
+    //*** current reading and the family at the scale (0 if none) ***
+    void liveWeight( float weight, qint32 key );
+
+private slots:
+
+    void handleDatagrams();
+
+private:
+
+    QUdpSocket  *sock_;
+    QHostAddress group_;
+
+    //*** stream state ***
+    bool    synced_;
+    quint32 nextSeq_;
+    qint32  value_;
+    qint32  key_;
+};
+
+#endif // LIVEWEIGHTRECEIVER_H
@@ -0,0 +1,150 @@
+#include "ScaleConfig.h"
+
+#include <fstream>
+#include <stdlib.h>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief trim - strips leading and trailing white space
+ */
+//*****************************************************************************
+static std::string trim( const std::string &str )
+{
+    size_t first = str.find_first_not_of( " \t\r\n" );
+    if ( first == std::string::npos ) return "";
+
+    size_t last = str.find_last_not_of( " \t\r\n" );
+
+    return str.substr( first, last - first + 1 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::load
+ * @param fileName
+ * @return
+ */
+//*****************************************************************************
+bool ScaleConfig::load( const std::string &fileName )
+{
+std::ifstream in( fileName.c_str() );
+std::string line;
+std::string section;
+
+    if ( !in.is_open() ) return false;
+
+    while ( std::getline( in, line ) )
+    {
+        line = trim( line );
+
+        //*** blank or comment ***
+        if ( line.empty() || line[0] == ';' || line[0] == '#' ) continue;
+
+        //*** [section] ***
+        if ( line[0] == '[' )
+        {
+            size_t end = line.find( ']' );
+            section = trim( line.substr( 1, end == std::string::npos ? std::string::npos : end - 1 ) );
+            continue;
+        }
+
+        //*** key=value ***
+        size_t eq = line.find( '=' );
+        if ( eq == std::string::npos ) continue;
+
+        std::string key = trim( line.substr( 0, eq ) );
+        if ( !section.empty() && section != "General" ) key = section + "/" + key;
+
+        values_[key] = trim( line.substr( eq + 1 ) );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::set
+ * @param key
+ * @param value
+ */
+//*****************************************************************************
+void ScaleConfig::set( const std::string &key, const std::string &value )
+{
+    values_[key] = value;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::getString
+ * @param key
+ * @param def
+ * @return
+ */
+//*****************************************************************************
+std::string ScaleConfig::getString( const std::string &key, const std::string &def )
+{
+    std::map<std::string,std::string>::const_iterator it = values_.find( key );
+
+    return ( it == values_.end() ) ? def : it->second;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::getInt
+ * @param key
+ * @param def
+ * @return
+ */
+//*****************************************************************************
+int ScaleConfig::getInt( const std::string &key, int def )
+{
+    std::string val = getString( key, "" );
+
+    return val.empty() ? def : atoi( val.c_str() );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::getDouble
+ * @param key
+ * @param def
+ * @return
+ */
+//*****************************************************************************
+double ScaleConfig::getDouble( const std::string &key, double def )
+{
+    std::string val = getString( key, "" );
+
+    return val.empty() ? def : strtod( val.c_str(), NULL );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleConfig::getBool
+ * @param key
+ * @param def
+ * @return
+ */
+//*****************************************************************************
+bool ScaleConfig::getBool( const std::string &key, bool def )
+{
+    std::string val = getString( key, "" );
+
+    if ( val.empty() ) return def;
+
+    return val == "true" || val == "1" || val == "yes" || val == "on";
+}
@@ -0,0 +1,38 @@
+#ifndef SCALECONFIG_H
+#define SCALECONFIG_H
+
+#include <string>
+#include <map>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The ScaleConfig class
+ *
+ * Settings for the scale server, read from an INI file in the same format as
+ * fpSvr.ini (keys are "section/key"), with command line overrides.
+ */
+//*****************************************************************************
+class ScaleConfig
+{
+public:
+
+    //*** reads an INI file, returns false if it can't be opened ***
+    bool load( const std::string &fileName );
+
+    //*** sets (overrides) a value ***
+    void set( const std::string &key, const std::string &value );
+
+    //*** get a value, or the default if not set ***
+    std::string getString( const std::string &key, const std::string &def );
+    int         getInt( const std::string &key, int def );
+    double      getDouble( const std::string &key, double def );
+    bool        getBool( const std::string &key, bool def );
+
+private:
+
+    std::map<std::string,std::string> values_;
+};
+
+#endif // SCALECONFIG_H
@@ -0,0 +1,872 @@
+#include "ScaleLink.h"
+#include "FpMessages.h"
+#include "EventLog.h"
+
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QNetworkDatagram>
+#include <QMetaObject>
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QFile>
+#include <QDebug>
+
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+//*** senders waiting on the local check-in socket ***
+const int LOCAL_BACKLOG = 8;
+
+
+//*** framed messages taken from the scale - anything else is skipped ***
+const ScaleLink::t_MsgHandler ScaleLink::msgHandlers_[] =
+{
+    { WEIGHT_REPORT_TYPE,     &ScaleLink::handleReport },
+    { WEIGHT_REPORT_SEQ_TYPE, &ScaleLink::handleReportSeq },
+    { WEIGHT_BATCH_TYPE,      &ScaleLink::handleBatch },
+    { HEARTBEAT_TYPE,         &ScaleLink::handleHeartbeat },
+    { COMMAND_RESULT_TYPE,    &ScaleLink::handleCommandResult }
+};
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::ScaleLink
+ * @param log
+ * @param settings
+ */
+//*****************************************************************************
+ScaleLink::ScaleLink( EventLog *log, const t_LinkSettings &settings ) : QObject(Q_NULLPTR)
+{
+    log_      = log;
+    settings_ = settings;
+
+    udp_            = Q_NULLPTR;
+    scaleSock_      = Q_NULLPTR;
+    scalePort_      = 0;
+    heartbeatTimer_ = Q_NULLPTR;
+    localFd_        = -1;
+    localNotifier_  = Q_NULLPTR;
+
+    connectTimeoutMs_  = settings.connectTimeoutMs;
+    attemptingConnect_ = false;
+    isConnected_       = false;
+    tmOutCnt_          = 0;
+
+    //*** sockets are created and serviced on the link thread ***
+    moveToThread( &thread_ );
+
+    connect( &thread_, SIGNAL(started()), SLOT(handleStart()) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::~ScaleLink
+ */
+//*****************************************************************************
+ScaleLink::~ScaleLink()
+{
+    if ( thread_.isRunning() )
+    {
+        //*** sockets belong to the link thread ***
+        QMetaObject::invokeMethod( this, "handleClose", Qt::BlockingQueuedConnection );
+
+        thread_.quit();
+        thread_.wait();
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::start
+ */
+//*****************************************************************************
+void ScaleLink::start()
+{
+    thread_.setObjectName( "ScaleLink" );
+    thread_.start();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::configure
+ * @param settings
+ */
+//*****************************************************************************
+void ScaleLink::configure( const t_LinkSettings &settings )
+{
+    {
+        QMutexLocker lock( &mutex_ );
+        settings_ = settings;
+    }
+
+    QMetaObject::invokeMethod( this, "applySettings", Qt::QueuedConnection );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::sendAck
+ * @param session
+ * @param seq
+ */
+//*****************************************************************************
+void ScaleLink::sendAck( quint32 session, quint32 seq )
+{
+    QMetaObject::invokeMethod( this, "writeAck", Qt::QueuedConnection, Q_ARG(quint32, session), Q_ARG(quint32, seq) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::sendCommand
+ * @param type
+ * @param value
+ */
+//*****************************************************************************
+void ScaleLink::sendCommand( quint32 type, float value )
+{
+    QMetaObject::invokeMethod( this, "writeCommand", Qt::QueuedConnection, Q_ARG(quint32, type), Q_ARG(float, value) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::resync
+ */
+//*****************************************************************************
+void ScaleLink::resync()
+{
+    QMetaObject::invokeMethod( this, "attemptReconnect", Qt::QueuedConnection );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleStart
+ */
+//*****************************************************************************
+void ScaleLink::handleStart()
+{
+    //*** create new UDP port to listen for FP packets ***
+    udp_ = new QUdpSocket( this );
+
+    //*** connect to 'needed'msg in' slot ***
+    connect( udp_, SIGNAL(readyRead()), SLOT(handlePendingDatagrams() ) );
+
+    scaleSock_ = new QTcpSocket( this );
+
+    //*** socket connections ***
+    connect( scaleSock_, SIGNAL(connected()), SLOT(handleTcpConnected()));
+    connect( scaleSock_, SIGNAL(disconnected()), SLOT(handleTcpDisconnected()));
+    connect( scaleSock_, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(handleTcpError(QAbstractSocket::SocketError)));
+    connect( scaleSock_, SIGNAL(readyRead()), SLOT(handleDataIn()) );
+
+    //*** the scale sends a heartbeat - check it is still talking ***
+    heartbeatTimer_ = new QTimer( this );
+    connect( heartbeatTimer_, SIGNAL(timeout()), SLOT(checkHeartbeat()) );
+    heartbeatTimer_->start( HEARTBEAT_INTERVAL_MS );
+
+    //*** bind, set up connection endpoint ***
+    applySettings();
+
+    //*** start attempting to connect ***
+    attemptReconnect();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleClose
+ */
+//*****************************************************************************
+void ScaleLink::handleClose()
+{
+    //*** stop all comms signals ***
+    if ( scaleSock_ ) scaleSock_->disconnect();
+
+    closeLocal();
+
+    delete heartbeatTimer_;
+    delete udp_;
+    delete scaleSock_;
+
+    heartbeatTimer_ = Q_NULLPTR;
+    udp_            = Q_NULLPTR;
+    scaleSock_      = Q_NULLPTR;
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Applies the settings from configure(). A new scale endpoint drops the
+ * connection so the retry loop picks it up, a new check-in port rebinds.
+ */
+//********************************************************************************
+void ScaleLink::applySettings()
+{
+t_LinkSettings settings;
+
+    if ( !udp_ ) return;
+
+    {
+        QMutexLocker lock( &mutex_ );
+        settings = settings_;
+    }
+
+    QHostAddress addr( settings.scaleAddr );
+
+    connectTimeoutMs_ = settings.connectTimeoutMs;
+
+    //*** new scale endpoint - reconnect (retry loop picks it up if not connected) ***
+    if ( addr != scaleAddr_ || settings.scalePort != scalePort_ )
+    {
+        scaleAddr_ = addr;
+        scalePort_ = settings.scalePort;
+
+        if ( isConnected_ ) scaleSock_->abort();
+    }
+
+    //*** new check-in port - rebind ***
+    if ( udp_->localPort() != settings.checkinPort )
+    {
+        udp_->close();
+
+        if ( !udp_->bind( QHostAddress::LocalHost, settings.checkinPort ) )
+        {
+            emit message( QString( "Unable to listen for check-ins on port %1" ).arg( settings.checkinPort ) );
+        }
+    }
+
+    //*** new local socket - reopen ***
+    if ( settings.checkinSocket != localPath_ || ( localFd_ < 0 && !localPath_.isEmpty() ) )
+    {
+        openLocal( settings.checkinSocket );
+    }
+
+    applySocketOptions();
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Opens the local check-in socket at path, replacing any socket left there by
+ * an earlier run. An empty path just closes it.
+ */
+//********************************************************************************
+void ScaleLink::openLocal( QString path )
+{
+    closeLocal();
+
+    localPath_ = path;
+
+    if ( path.isEmpty() ) return;
+
+#ifdef Q_OS_UNIX
+struct sockaddr_un addr;
+QByteArray name = QFile::encodeName( path );
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+
+    if ( name.size() >= (int)sizeof(addr.sun_path) )
+    {
+        emit message( "Local check-in socket path too long : " + path );
+        return;
+    }
+
+    memcpy( addr.sun_path, name.constData(), name.size() );
+
+    int fd = ::socket( AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+
+    if ( fd < 0 )
+    {
+        emit message( QString( "Local check-in socket : %1" ).arg( strerror( errno ) ) );
+        return;
+    }
+
+    //*** left over from a previous run ***
+    ::unlink( name.constData() );
+
+    if ( ::bind( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 || ::listen( fd, LOCAL_BACKLOG ) < 0 )
+    {
+        emit message( QString( "Unable to listen for check-ins on %1 : %2" ).arg( path ).arg( strerror( errno ) ) );
+        ::close( fd );
+        return;
+    }
+
+    localFd_ = fd;
+
+    localNotifier_ = new QSocketNotifier( fd, QSocketNotifier::Read, this );
+    connect( localNotifier_, SIGNAL(activated(int)), SLOT(acceptLocal()) );
+#else
+    emit message( "Local check-in socket not supported here, using UDP only" );
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::closeLocal
+ */
+//*****************************************************************************
+void ScaleLink::closeLocal()
+{
+#ifdef Q_OS_UNIX
+    while ( !localClients_.isEmpty() )
+    {
+        closeLocalClient( localClients_.begin().key() );
+    }
+
+    if ( localFd_ >= 0 )
+    {
+        delete localNotifier_;
+        localNotifier_ = Q_NULLPTR;
+
+        ::close( localFd_ );
+        ::unlink( QFile::encodeName( localPath_ ).constData() );
+        localFd_ = -1;
+    }
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::closeLocalClient
+ * @param fd
+ */
+//*****************************************************************************
+void ScaleLink::closeLocalClient( int fd )
+{
+#ifdef Q_OS_UNIX
+    QSocketNotifier *notifier = localClients_.take( fd );
+
+    //*** may be in its own activated() - stop it now, delete it later ***
+    if ( notifier )
+    {
+        notifier->setEnabled( false );
+        notifier->deleteLater();
+    }
+
+    ::close( fd );
+#else
+    Q_UNUSED( fd );
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::acceptLocal
+ */
+//*****************************************************************************
+void ScaleLink::acceptLocal()
+{
+#ifdef Q_OS_UNIX
+    while ( localFd_ >= 0 )
+    {
+        int fd = ::accept4( localFd_, Q_NULLPTR, Q_NULLPTR, SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+        if ( fd < 0 )
+        {
+            if ( errno == EINTR ) continue;
+            if ( errno != EAGAIN && errno != EWOULDBLOCK ) qDebug() << "Local check-in accept failed:" << strerror( errno );
+            return;
+        }
+
+        QSocketNotifier *notifier = new QSocketNotifier( fd, QSocketNotifier::Read, this );
+        connect( notifier, SIGNAL(activated(int)), SLOT(readLocal(int)) );
+
+        localClients_.insert( fd, notifier );
+    }
+#endif
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::readLocal
+ * @param fd
+ */
+//*****************************************************************************
+void ScaleLink::readLocal( int fd )
+{
+#ifdef Q_OS_UNIX
+char buf[CHECKIN_SIZE + 1];
+
+    //*** one message per recv - a short or long one is a bad check-in ***
+    while ( true )
+    {
+        ssize_t num = ::recv( fd, buf, sizeof(buf), 0 );
+
+        if ( num > 0 )
+        {
+            handleCheckInMsg( buf, (int)num );
+            continue;
+        }
+
+        if ( num < 0 && errno == EINTR ) continue;
+        if ( num < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) return;
+
+        //*** sender closed (or failed) ***
+        closeLocalClient( fd );
+        return;
+    }
+#else
+    Q_UNUSED( fd );
+#endif
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Applies configured socket buffer sizes (0 leaves the system default).
+ */
+//********************************************************************************
+void ScaleLink::applySocketOptions()
+{
+int recvSize;
+int sendSize;
+
+    {
+        QMutexLocker lock( &mutex_ );
+        recvSize = settings_.recvBufferSize;
+        sendSize = settings_.sendBufferSize;
+    }
+
+    if ( recvSize > 0 )
+    {
+        udp_->setSocketOption( QAbstractSocket::ReceiveBufferSizeSocketOption, recvSize );
+        scaleSock_->setSocketOption( QAbstractSocket::ReceiveBufferSizeSocketOption, recvSize );
+    }
+
+    if ( sendSize > 0 )
+    {
+        scaleSock_->setSocketOption( QAbstractSocket::SendBufferSizeSocketOption, sendSize );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handlePendingDatagrams
+ */
+//*****************************************************************************
+void ScaleLink::handlePendingDatagrams()
+{
+    // process all datagrams that are pending
+    while (udp_->hasPendingDatagrams())
+    {
+        // get the datagram
+        QNetworkDatagram datagram = udp_->receiveDatagram();
+
+        // pull out the bytes
+        QByteArray msg = datagram.data();
+
+        handleCheckInMsg( msg.constData(), msg.size() );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleCheckInMsg
+ * @param data
+ * @param size
+ */
+//*****************************************************************************
+void ScaleLink::handleCheckInMsg( const char *data, int size )
+{
+t_CheckIn ci;
+
+    if ( size != CHECKIN_SIZE )
+    {
+        qDebug() << "Invalid checkin message size received!!!";
+        return;
+    }
+
+    memcpy( &ci, data, CHECKIN_SIZE );
+    int nameLen = qstrnlen( ci.name, sizeof(ci.name) );
+
+    log_->record( LOG_CHECKIN, ci.key, 0, ci.numItems, ci.day, ci.name, nameLen );
+
+    //*** send to scale server if connected ***
+    if ( isConnected_ )
+    {
+        scaleSock_->write( (const char*)&ci, CHECKIN_SIZE );
+    }
+
+    emit checkIn( ci.key, ci.numItems, QString::fromUtf8( ci.name, nameLen ) );
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Closes the socket if it is open and starts an asynchronous connection attempt. On timeout, checkConnectionFailed() will be called.
+ *
+ * If we are already trying to connect, this function does nothing.
+ */
+//********************************************************************************
+void ScaleLink::attemptReconnect()
+{
+    // only continue if we're not already connecting
+    if (!attemptingConnect_)
+    {
+       if (scaleSock_->isOpen())
+       {
+          scaleSock_->close();
+       }
+
+       // attempt the connect. we will check later if it succeeded.
+       isConnected_ = false;
+       attemptingConnect_ = true;
+       scaleSock_->connectToHost( scaleAddr_, scalePort_, QAbstractSocket::ReadWrite);
+
+       // after the timeout, check if we have connected. If the connection succeeds, connected() will handle going forward and this timeout will do nothing
+       QTimer::singleShot(connectTimeoutMs_, this, SLOT(checkConnectionFailed()));
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Called after the timeout is reached after attemptReconnect() is called. If the socket is still closed, it is assumed that an error occurred
+ * and attempts a reconnect. If the socket is open, nothing more happens.
+ */
+//********************************************************************************
+void ScaleLink::checkConnectionFailed()
+{
+    if ( !scaleSock_ ) return;
+
+    if (!isConnected_)
+    {
+       // connection failed, try again
+       tmOutCnt_++;
+       if ( tmOutCnt_ % 60 == 0 )
+       {
+          emit message( "Unable to connect, retrying..." );
+       }
+
+       attemptingConnect_ = false;
+
+       //*** stop connect ***
+       scaleSock_->abort();
+
+       //*** try connect again ***
+       attemptReconnect();
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Occurs when the tcp socket connects.
+ */
+//********************************************************************************
+void ScaleLink::handleTcpConnected()
+{
+    log_->record( LOG_CONNECTED, 0 );
+
+    isConnected_ = true;
+    attemptingConnect_ = false;
+    tmOutCnt_ = 0;
+    lastRx_.start();
+
+    //*** buffer sizes can only be set on a connected socket ***
+    applySocketOptions();
+
+    emit linkChanged( true );
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Occurs when the tcp socket disconnects. Attempts a reconnect.
+ */
+//********************************************************************************
+void ScaleLink::handleTcpDisconnected()
+{
+    log_->record( LOG_DISCONNECTED, 0 );
+
+    attemptingConnect_ = false;
+    attemptReconnect();
+
+    emit linkChanged( false );
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Occurs if an error is thrown by the TCP socket. Logs the error.
+ *
+ * This does not attempt a reconnect as many of the error types happen immediately on connectToHost and would result in an infinite loop.
+ * If an error occurs and the socket disconnects, a reconnect will be attempted by handleTcpDisconnected() or checkConnectionFailed().
+ *
+ * @param e  The type of error that occurred
+ */
+//********************************************************************************
+void ScaleLink::handleTcpError( QAbstractSocket::SocketError e )
+{
+    if ( e != QAbstractSocket::ConnectionRefusedError )
+    {
+        emit message( "TCP Error: " + scaleSock_->errorString() );
+        qDebug() << "Error (" << e << "): " << scaleSock_->errorString();
+    }
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Occurs when there is data available on the TCP socket (from the scale)
+ */
+//********************************************************************************
+void ScaleLink::handleDataIn()
+{
+t_MsgHeader hdr;
+char        frame[MSG_SIZE_OFFSET + MSG_MAX_SIZE];
+
+    if ( !scaleSock_ ) return;
+
+    //*** anything at all shows the scale is alive ***
+    if ( scaleSock_->bytesAvailable() > 0 ) lastRx_.start();
+
+    //*** get data - whole messages only ***
+    while ( scaleSock_->bytesAvailable() >= MSG_HEADER_SIZE )
+    {
+        scaleSock_->peek( (char*)&hdr, MSG_HEADER_SIZE );
+
+        //*** out of step - skip a byte until a header lines up ***
+        if ( hdr.magic != (quint32)MAGIC_VAL || hdr.size > MSG_MAX_SIZE )
+        {
+            scaleSock_->read( (char*)&hdr, 1 );
+            continue;
+        }
+
+        qint64 msgSize = MSG_SIZE_OFFSET + (qint64)hdr.size;
+        if ( scaleSock_->bytesAvailable() < msgSize ) break;
+
+        const t_MsgType    *msgType = findMsgType( hdr.type );
+        const t_MsgHandler *handler = Q_NULLPTR;
+
+        for ( size_t i = 0; i < sizeof(msgHandlers_) / sizeof(msgHandlers_[0]); i++ )
+        {
+            if ( msgHandlers_[i].type == hdr.type ) handler = &msgHandlers_[i];
+        }
+
+        //*** unknown message, or not whole - skip it ***
+        if ( !handler || !msgType || !isFrameValid( msgType, msgSize ) )
+        {
+            scaleSock_->read( msgSize );
+            continue;
+        }
+
+        scaleSock_->read( frame, msgSize );
+        ( this->*handler->handler )( frame, msgSize );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleReport
+ * @param frame
+ */
+//*****************************************************************************
+void ScaleLink::handleReport( const char *frame, qint64 )
+{
+t_WeightReport wr;
+
+    memcpy( &wr, frame, WEIGHT_REPORT_SIZE );
+
+    emit weightReport( wr.key, wr.weight, wr.day, 0, 0 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleReportSeq
+ * @param frame
+ */
+//*****************************************************************************
+void ScaleLink::handleReportSeq( const char *frame, qint64 )
+{
+t_WeightReportSeq wrs;
+
+    memcpy( &wrs, frame, WEIGHT_REPORT_SEQ_SIZE );
+
+    emit weightReport( wrs.key, wrs.weight, wrs.day, wrs.session, wrs.seq );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleBatch
+ * @param frame
+ * @param size
+ */
+//*****************************************************************************
+void ScaleLink::handleBatch( const char *frame, qint64 size )
+{
+t_WeightBatch batch;
+t_BatchEntry  entry;
+
+    memcpy( &batch, frame, WEIGHT_BATCH_SIZE );
+
+    //*** count must agree with the frame ***
+    if ( (qint64)batch.count != ( size - WEIGHT_BATCH_SIZE ) / BATCH_ENTRY_SIZE ) return;
+
+    for ( quint32 i = 0; i < batch.count; i++ )
+    {
+        memcpy( &entry, frame + WEIGHT_BATCH_SIZE + i * BATCH_ENTRY_SIZE, BATCH_ENTRY_SIZE );
+
+        emit weightReport( entry.key, entry.weight, entry.day, batch.session, entry.seq );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleHeartbeat
+ */
+//*****************************************************************************
+void ScaleLink::handleHeartbeat( const char *, qint64 )
+{
+    //*** nothing to do - lastRx_ is already updated ***
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::handleCommandResult
+ * @param frame
+ */
+//*****************************************************************************
+void ScaleLink::handleCommandResult( const char *frame, qint64 )
+{
+t_CommandResult result;
+const char *status;
+
+    memcpy( &result, frame, COMMAND_RESULT_SIZE );
+
+    const t_MsgType *command = findMsgType( result.command );
+
+    switch ( result.status )
+    {
+    case COMMAND_OK:      status = "done";    break;
+    case COMMAND_REFUSED: status = "refused"; break;
+    default:              status = "failed";  break;
+    }
+
+    emit message( QString( "Scale %1 %2, reading %3" )
+                  .arg( command ? command->name : "command" )
+                  .arg( status )
+                  .arg( result.value, 0, 'f', 2 ) );
+}
+
+
+//********************************************************************************
+//********************************************************************************
+/**
+ * Drops the connection if nothing has come from the scale, not even a
+ * heartbeat, for HEARTBEAT_TIMEOUT_MS. The retry loop then reconnects.
+ */
+//********************************************************************************
+void ScaleLink::checkHeartbeat()
+{
+    if ( !isConnected_ || lastRx_.elapsed() < HEARTBEAT_TIMEOUT_MS ) return;
+
+    emit message( "No heartbeat from the scale, reconnecting" );
+
+    scaleSock_->abort();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::writeAck
+ * @param session
+ * @param seq
+ */
+//*****************************************************************************
+void ScaleLink::writeAck( quint32 session, quint32 seq )
+{
+t_WeightAck ack;
+
+    //*** not connected - the scale resends, and is acked then ***
+    if ( !isConnected_ ) return;
+
+    ack.magic   = MAGIC_VAL;
+    ack.size    = WEIGHT_ACK_SIZE - MSG_SIZE_OFFSET;
+    ack.type    = WEIGHT_ACK_TYPE;
+    ack.session = session;
+    ack.seq     = seq;
+
+    scaleSock_->write( (const char*)&ack, WEIGHT_ACK_SIZE );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleLink::writeCommand
+ * @param type
+ * @param value
+ */
+//*****************************************************************************
+void ScaleLink::writeCommand( quint32 type, float value )
+{
+t_ScaleCommand command;
+
+    if ( !isConnected_ )
+    {
+        emit message( "Not connected to the scale" );
+        return;
+    }
+
+    command.magic = MAGIC_VAL;
+    command.size  = SCALE_COMMAND_SIZE - MSG_SIZE_OFFSET;
+    command.type  = type;
+    command.value = value;
+
+    scaleSock_->write( (const char*)&command, SCALE_COMMAND_SIZE );
+}
@@ -0,0 +1,231 @@
+#ifndef SCALELINK_H
+#define SCALELINK_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QAbstractSocket>
+
+class QUdpSocket;
+class QTcpSocket;
+class QTimer;
+class QSocketNotifier;
+class EventLog;
+
+
+//*** network settings, taken from FpConfig on the GUI thread ***
+typedef struct
+{
+    QString scaleAddr;
+    quint16 scalePort;
+    quint16 checkinPort;
+    QString checkinSocket;      // local SOCK_SEQPACKET path, empty - UDP only
+    int     connectTimeoutMs;
+    int     recvBufferSize;     // 0 = system default
+    int     sendBufferSize;
+} t_LinkSettings;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The ScaleLink class
+ *
+ * Owns the check-in listeners and the connection to the scale server, and
+ * services them on its own thread, so nothing the window does can hold up the
+ * sockets. Check-ins are forwarded to the scale from this thread. Check-ins
+ * and weight reports reach the window through queued signals, and acks and
+ * commands go back to the scale through sendAck() and sendCommand().
+ *
+ * Check-ins arrive on loopback UDP and, on Unix, optionally on a local
+ * SOCK_SEQPACKET socket. The local socket is reliable and ordered, and a
+ * sender that gets ahead of us blocks instead of losing check-ins. UDP stays
+ * open for senders that don't use it.
+ *
+ * Framed messages are dispatched by type through a handler table. The scale
+ * sends a heartbeat, and a link that stays silent for HEARTBEAT_TIMEOUT_MS
+ * is dropped and reconnected.
+ */
+//*****************************************************************************
+class ScaleLink : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor - events go to the log ***
+    explicit ScaleLink( EventLog *log, const t_LinkSettings &settings );
+
+    //*** destructor - closes the sockets and stops the thread ***
+    ~ScaleLink();
+
+    //*** starts the thread, the sockets are created on it ***
+    void start();
+
+    //*** new settings, applied on the link thread (any thread) ***
+    void configure( const t_LinkSettings &settings );
+
+    //*** tells the scale everything up to seq is stored (any thread) ***
+    void sendAck( quint32 session, quint32 seq );
+
+    //*** sends a tare / calibrate command, value is the reference weight (any thread) ***
+    void sendCommand( quint32 type, float value );
+
+    //*** drops the scale connection and reconnects, so it resends all not acked (any thread) ***
+    void resync();
+
+signals:
+
+    //*** scale server connected / disconnected ***
+    void linkChanged( bool connected );
+
+    //*** check-in from the front desk (already forwarded to the scale) ***
+    void checkIn( qint32 key, qint32 numItems, QString name );
+
+    //*** weight from the scale, seq 0 if not sequenced ***
+    void weightReport( qint32 key, float weight, qint64 day, quint32 session, quint32 seq );
+
+    //*** for the window ***
+    void message( QString text );
+
+private slots:
+
+    //*** run on the link thread ***
+    void handleStart();
+    void handleClose();
+    void applySettings();
+    void writeAck( quint32 session, quint32 seq );
+    void writeCommand( quint32 type, float value );
+
+    //*** drops a silent link ***
+    void checkHeartbeat();
+
+    //*** local socket data ***
+    void handlePendingDatagrams();
+
+    //*** local check-in socket - new senders, and data from one ***
+    void acceptLocal();
+    void readLocal( int fd );
+
+    //********************************************************************************
+    //********************************************************************************
+    /**
+     * Closes the socket if it is open and starts an asynchronous connection attempt. On timeout, checkConnectionFailed() will be called.
+     *
+     * If we are already trying to connect, this function does nothing.
+     */
+    //********************************************************************************
+    void attemptReconnect();
+
+
+    //********************************************************************************
+    //********************************************************************************
+    /**
+     * Called after the timeout is reached after attemptReconnect() is called. If the socket is still closed, it is assumed that an error occurred
+     * and attempts a reconnect. If the socket is open, nothing more happens.
+     */
+    //********************************************************************************
+    void checkConnectionFailed();
+
+
+    //********************************************************************************
+    //********************************************************************************
+    /**
+     * Occurs when the tcp socket connects.
+     */
+    //********************************************************************************
+    void handleTcpConnected();
+
+
+    //********************************************************************************
+    //********************************************************************************
+    /**
+     * Occurs when the tcp socket disconnects. Attempts a reconnect.
+     */
+    //********************************************************************************
+    void handleTcpDisconnected();
+
+
+    //********************************************************************************
+    //********************************************************************************
+    /**
+     * Occurs if an error is thrown by the TCP socket. Logs the error.
+     *
+     * This does not attempt a reconnect as many of the error types happen immediately on connectToHost and would result in an infinite loop.
+     * If an error occurs and the socket disconnects, a reconnect will be attempted by handleTcpDisconnected() or checkConnectionFailed().
+     *
+     * @param e  The type of error that occurred
+     */
+    //********************************************************************************
+    void handleTcpError( QAbstractSocket::SocketError e );
+
+
+    void handleDataIn();
+
+private:
+
+    //*** applies configured socket buffer sizes ***
+    void applySocketOptions();
+
+    //*** opens / closes the local check-in socket ***
+    void openLocal( QString path );
+    void closeLocal();
+    void closeLocalClient( int fd );
+
+    //*** one check-in, from either listener ***
+    void handleCheckInMsg( const char *data, int size );
+
+    //*** framed messages from the scale, by type ***
+    typedef void (ScaleLink::*MsgHandler)( const char *frame, qint64 size );
+
+    typedef struct
+    {
+        quint32    type;
+        MsgHandler handler;
+    } t_MsgHandler;
+
+    static const t_MsgHandler msgHandlers_[];
+
+    void handleReport( const char *frame, qint64 size );
+    void handleReportSeq( const char *frame, qint64 size );
+    void handleBatch( const char *frame, qint64 size );
+    void handleHeartbeat( const char *frame, qint64 size );
+    void handleCommandResult( const char *frame, qint64 size );
+
+    QThread thread_;
+
+    EventLog *log_;
+
+    //*** settings - written by configure(), taken on the link thread (mutex_) ***
+    QMutex         mutex_;
+    t_LinkSettings settings_;
+
+    //*** Windows 'Named Pipe' server ***
+    QUdpSocket *udp_;
+
+    //*** local check-in socket and its senders ***
+    int                         localFd_;
+    QString                     localPath_;
+    QSocketNotifier            *localNotifier_;
+    QHash<int,QSocketNotifier*> localClients_;
+
+    //*** client socket to talk to scale server ***
+    QTcpSocket *scaleSock_;
+
+    QHostAddress scaleAddr_;
+    quint16      scalePort_;
+    int          connectTimeoutMs_;
+
+    bool attemptingConnect_;   // True if we are attempting to connect, false if we are connected or disconnected
+    bool isConnected_;         // True if we are connected to the TCP server
+    int tmOutCnt_;
+
+    //*** time since anything was heard from the scale ***
+    QElapsedTimer lastRx_;
+    QTimer       *heartbeatTimer_;
+};
+
+#endif // SCALELINK_H
@@ -0,0 +1,854 @@
+#include "ScaleServer.h"
+#include "LivePublisher.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+
+//*** epoll events handled per wait ***
+const int MAX_EVENTS = 16;
+
+//*** client is dropped if this many report bytes are unsent ***
+const size_t MAX_CLIENT_BACKLOG = 1024 * 1024;
+
+//*** unacknowledged reports kept (oldest dropped beyond this) ***
+const size_t MAX_UNACKED = 4096;
+
+
+//*** framed messages taken from fpSvr - anything else is skipped ***
+const ScaleServer::t_FrameHandler ScaleServer::frameHandlers_[] =
+{
+    { WEIGHT_ACK_TYPE,      &ScaleServer::handleAck },
+    { SCALE_TARE_TYPE,      &ScaleServer::handleCommand },
+    { SCALE_CALIBRATE_TYPE, &ScaleServer::handleCommand },
+    { SCALE_SLEEP_TYPE,     &ScaleServer::handleCommand },
+    { SCALE_WAKE_TYPE,      &ScaleServer::handleCommand }
+};
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::ScaleServer
+ */
+//*****************************************************************************
+ScaleServer::ScaleServer()
+{
+    listenFd_    = -1;
+    epollFd_     = -1;
+    eventFd_     = -1;
+    signalFd_    = -1;
+    timerFd_     = -1;
+    heartbeatFd_ = -1;
+    live_        = NULL;
+    haveFamily_  = false;
+    currentKey_  = 0;
+    currentDay_  = 0;
+
+    //*** new sequence space each run ***
+    session_     = (uint32_t)time( NULL ) ^ ( (uint32_t)getpid() << 16 );
+    if ( session_ == 0 ) session_ = 1;
+    nextSeq_     = 1;
+    window_      = 1;
+    pumpPending_ = false;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::~ScaleServer
+ */
+//*****************************************************************************
+ScaleServer::~ScaleServer()
+{
+    for ( std::map<int,t_Client>::iterator it = clients_.begin(); it != clients_.end(); ++it )
+    {
+        close( it->first );
+    }
+
+    if ( listenFd_ >= 0 )    close( listenFd_ );
+    if ( eventFd_ >= 0 )     close( eventFd_ );
+    if ( signalFd_ >= 0 )    close( signalFd_ );
+    if ( timerFd_ >= 0 )     close( timerFd_ );
+    if ( heartbeatFd_ >= 0 ) close( heartbeatFd_ );
+    if ( epollFd_ >= 0 )     close( epollFd_ );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::start
+ * @param port
+ * @param window - reports in flight before waiting for an ack
+ * @return
+ */
+//*****************************************************************************
+bool ScaleServer::start( uint16_t port, int window )
+{
+struct sockaddr_in addr;
+struct epoll_event ev;
+struct itimerspec period;
+sigset_t mask;
+int on = 1;
+
+    epollFd_ = epoll_create1( EPOLL_CLOEXEC );
+    if ( epollFd_ < 0 )
+    {
+        printf( "ScaleServer: epoll_create1 failed: %s\n", strerror( errno ) );
+        return false;
+    }
+
+    //*** listen socket ***
+    listenFd_ = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( listenFd_ < 0 )
+    {
+        printf( "ScaleServer: socket failed: %s\n", strerror( errno ) );
+        return false;
+    }
+
+    setsockopt( listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) );
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+    addr.sin_port        = htons( port );
+
+    if ( bind( listenFd_, (struct sockaddr *)&addr, sizeof(addr) ) < 0 || listen( listenFd_, 4 ) < 0 )
+    {
+        printf( "ScaleServer: can't listen on port %d: %s\n", port, strerror( errno ) );
+        return false;
+    }
+
+    //*** wakeup from the sampler thread ***
+    eventFd_ = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    //*** stop signals (already blocked by the caller) ***
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGINT );
+    sigaddset( &mask, SIGTERM );
+    signalFd_ = signalfd( -1, &mask, SFD_NONBLOCK | SFD_CLOEXEC );
+
+    //*** heartbeat to every client ***
+    heartbeatFd_ = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+
+    if ( eventFd_ < 0 || signalFd_ < 0 || heartbeatFd_ < 0 )
+    {
+        printf( "ScaleServer: eventfd / signalfd / timerfd failed: %s\n", strerror( errno ) );
+        return false;
+    }
+
+    memset( &period, 0, sizeof(period) );
+    period.it_interval.tv_sec  = HEARTBEAT_INTERVAL_MS / 1000;
+    period.it_interval.tv_nsec = ( HEARTBEAT_INTERVAL_MS % 1000 ) * 1000000L;
+    period.it_value            = period.it_interval;
+    timerfd_settime( heartbeatFd_, 0, &period, NULL );
+
+    int fds[] = { listenFd_, eventFd_, signalFd_, heartbeatFd_ };
+
+    for ( unsigned i = 0; i < sizeof(fds) / sizeof(fds[0]); i++ )
+    {
+        memset( &ev, 0, sizeof(ev) );
+        ev.events  = EPOLLIN;
+        ev.data.fd = fds[i];
+        epoll_ctl( epollFd_, EPOLL_CTL_ADD, fds[i], &ev );
+    }
+
+    //*** no more in flight than are kept (fpSvr holds up to the same number) ***
+    window_ = std::max( 1, std::min( window, (int)MAX_UNACKED ) );
+
+    printf( "ScaleServer: listening on port %d, session %u\n", port, session_ );
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::startLive
+ * @param publisher
+ * @param source
+ * @param rateHz
+ * @return
+ */
+//*****************************************************************************
+bool ScaleServer::startLive( LivePublisher *publisher, std::function<float()> source, int rateHz )
+{
+struct itimerspec period;
+struct epoll_event ev;
+
+    if ( rateHz < 1 ) rateHz = 1;
+    if ( rateHz > 50 ) rateHz = 50;
+
+    timerFd_ = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    if ( timerFd_ < 0 )
+    {
+        printf( "ScaleServer: timerfd_create failed: %s\n", strerror( errno ) );
+        return false;
+    }
+
+    memset( &period, 0, sizeof(period) );
+    period.it_interval.tv_nsec = 1000000000L / rateHz;
+    period.it_value            = period.it_interval;
+    timerfd_settime( timerFd_, 0, &period, NULL );
+
+    memset( &ev, 0, sizeof(ev) );
+    ev.events  = EPOLLIN;
+    ev.data.fd = timerFd_;
+    epoll_ctl( epollFd_, EPOLL_CTL_ADD, timerFd_, &ev );
+
+    live_       = publisher;
+    liveSource_ = source;
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::run
+ */
+//*****************************************************************************
+void ScaleServer::run()
+{
+struct epoll_event events[MAX_EVENTS];
+bool running = true;
+
+    while ( running )
+    {
+        int num = epoll_wait( epollFd_, events, MAX_EVENTS, -1 );
+
+        if ( num < 0 )
+        {
+            if ( errno == EINTR ) continue;
+
+            printf( "ScaleServer: epoll_wait failed: %s\n", strerror( errno ) );
+            break;
+        }
+
+        for ( int i = 0; i < num; i++ )
+        {
+            int fd = events[i].data.fd;
+
+            if ( fd == listenFd_ )
+            {
+                acceptClients();
+            }
+            else if ( fd == eventFd_ )
+            {
+                handlePosted();
+            }
+            else if ( fd == timerFd_ )
+            {
+                handleLiveTimer();
+            }
+            else if ( fd == heartbeatFd_ )
+            {
+                handleHeartbeat();
+            }
+            else if ( fd == signalFd_ )
+            {
+                struct signalfd_siginfo info;
+
+                if ( read( signalFd_, &info, sizeof(info) ) == sizeof(info) )
+                {
+                    printf( "ScaleServer: signal %d, stopping\n", info.ssi_signo );
+                    running = false;
+                }
+            }
+            else
+            {
+                std::map<int,t_Client>::iterator it = clients_.find( fd );
+                if ( it == clients_.end() ) continue;
+
+                bool ok = !( events[i].events & ( EPOLLERR | EPOLLHUP ) );
+
+                if ( ok && ( events[i].events & EPOLLIN ) )  ok = readClient( it->second );
+                if ( ok && ( events[i].events & EPOLLOUT ) ) ok = flushClient( it->second );
+
+                if ( !ok ) closeClient( fd );
+            }
+        }
+
+        //*** new reports, acks or clients - send what the window allows ***
+        if ( pumpPending_ ) pumpAll();
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::postWeight
+ * @param weight
+ */
+//*****************************************************************************
+void ScaleServer::postWeight( float weight )
+{
+uint64_t one = 1;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        pending_.push_back( weight );
+    }
+
+    //*** wake the loop ***
+    if ( write( eventFd_, &one, sizeof(one) ) < 0 && errno != EAGAIN )
+    {
+        printf( "ScaleServer: eventfd write failed: %s\n", strerror( errno ) );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::postResult
+ * @param command
+ * @param status
+ * @param value
+ */
+//*****************************************************************************
+void ScaleServer::postResult( uint32_t command, int32_t status, float value )
+{
+t_CommandResult result;
+uint64_t one = 1;
+
+    memset( &result, 0, sizeof(result) );
+    result.magic   = MAGIC_VAL;
+    result.size    = COMMAND_RESULT_SIZE - MSG_SIZE_OFFSET;
+    result.type    = COMMAND_RESULT_TYPE;
+    result.command = command;
+    result.status  = status;
+    result.value   = value;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        results_.push_back( result );
+    }
+
+    //*** wake the loop ***
+    if ( write( eventFd_, &one, sizeof(one) ) < 0 && errno != EAGAIN )
+    {
+        printf( "ScaleServer: eventfd write failed: %s\n", strerror( errno ) );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::acceptClients
+ */
+//*****************************************************************************
+void ScaleServer::acceptClients()
+{
+struct epoll_event ev;
+int on = 1;
+
+    while ( true )
+    {
+        int fd = accept4( listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+        if ( fd < 0 )
+        {
+            if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+            {
+                printf( "ScaleServer: accept failed: %s\n", strerror( errno ) );
+            }
+            return;
+        }
+
+        //*** reports are small - send them straight away ***
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on) );
+
+        memset( &ev, 0, sizeof(ev) );
+        ev.events  = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+
+        if ( epoll_ctl( epollFd_, EPOLL_CTL_ADD, fd, &ev ) < 0 )
+        {
+            close( fd );
+            continue;
+        }
+
+        t_Client &client = clients_[fd];
+        client.fd      = fd;
+        client.wantOut = false;
+        client.sentSeq = 0;
+
+        //*** anything unacked is resent ***
+        pumpPending_ = true;
+
+        printf( "ScaleServer: client connected (%d)\n", (int)clients_.size() );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::readClient
+ * @param client
+ * @return - FALSE if the client should be closed
+ */
+//*****************************************************************************
+bool ScaleServer::readClient( t_Client &client )
+{
+char buf[4096];
+t_CheckIn checkIn;
+t_MsgHeader hdr;
+uint32_t magic;
+bool eof = false;
+
+    while ( true )
+    {
+        ssize_t num = read( client.fd, buf, sizeof(buf) );
+
+        //*** closed - still handle what came before it ***
+        if ( num == 0 )
+        {
+            eof = true;
+            break;
+        }
+
+        if ( num < 0 )
+        {
+            if ( errno == EINTR ) continue;
+            if ( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+            return false;
+        }
+
+        client.in.append( buf, num );
+    }
+
+    //*** whole messages only ***
+    size_t offset = 0;
+
+    while ( client.in.size() - offset >= sizeof(magic) )
+    {
+        size_t avail = client.in.size() - offset;
+
+        memcpy( &magic, client.in.data() + offset, sizeof(magic) );
+
+        if ( magic == (uint32_t)MAGIC_VAL )
+        {
+            //*** framed message ***
+            if ( avail < (size_t)MSG_HEADER_SIZE ) break;
+
+            memcpy( &hdr, client.in.data() + offset, MSG_HEADER_SIZE );
+            if ( hdr.size > MSG_MAX_SIZE ) return false;
+
+            size_t frame = MSG_SIZE_OFFSET + hdr.size;
+            if ( frame < (size_t)MSG_HEADER_SIZE ) return false;
+            if ( avail < frame ) break;
+
+            //*** known type, whole frame - to its handler ***
+            const t_MsgType *msgType = findMsgType( hdr.type );
+
+            if ( msgType && isFrameValid( msgType, frame ) )
+            {
+                for ( size_t i = 0; i < sizeof(frameHandlers_) / sizeof(frameHandlers_[0]); i++ )
+                {
+                    if ( frameHandlers_[i].type != hdr.type ) continue;
+
+                    ( this->*frameHandlers_[i].handler )( client.in.data() + offset, frame );
+                    break;
+                }
+            }
+
+            offset += frame;
+        }
+        else
+        {
+            //*** relayed check-in ***
+            if ( avail < (size_t)CHECKIN_SIZE ) break;
+
+            memcpy( &checkIn, client.in.data() + offset, CHECKIN_SIZE );
+            offset += CHECKIN_SIZE;
+
+            checkIn.name[CHECKIN_NAME_MAX] = 0;
+            handleCheckIn( checkIn );
+        }
+    }
+
+    client.in.erase( 0, offset );
+
+    return !eof;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::flushClient
+ * @param client
+ * @return - FALSE if the client should be closed
+ */
+//*****************************************************************************
+bool ScaleServer::flushClient( t_Client &client )
+{
+struct epoll_event ev;
+
+    while ( !client.out.empty() )
+    {
+        ssize_t num = send( client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL );
+
+        if ( num < 0 )
+        {
+            if ( errno == EINTR ) continue;
+            if ( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+            return false;
+        }
+
+        client.out.erase( 0, num );
+    }
+
+    //*** only watch for writable while something is waiting ***
+    bool wantOut = !client.out.empty();
+
+    if ( wantOut != client.wantOut )
+    {
+        memset( &ev, 0, sizeof(ev) );
+        ev.events  = EPOLLIN | EPOLLRDHUP | ( wantOut ? (uint32_t)EPOLLOUT : 0u );
+        ev.data.fd = client.fd;
+        epoll_ctl( epollFd_, EPOLL_CTL_MOD, client.fd, &ev );
+
+        client.wantOut = wantOut;
+    }
+
+    return client.out.size() <= MAX_CLIENT_BACKLOG;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::closeClient
+ * @param fd
+ */
+//*****************************************************************************
+void ScaleServer::closeClient( int fd )
+{
+    epoll_ctl( epollFd_, EPOLL_CTL_DEL, fd, NULL );
+    close( fd );
+
+    clients_.erase( fd );
+
+    printf( "ScaleServer: client disconnected (%d)\n", (int)clients_.size() );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handleCheckIn
+ * @param checkIn
+ */
+//*****************************************************************************
+void ScaleServer::handleCheckIn( const t_CheckIn &checkIn )
+{
+    //*** no items - family has left the scale ***
+    if ( checkIn.numItems == 0 )
+    {
+        if ( haveFamily_ && checkIn.key == currentKey_ ) haveFamily_ = false;
+        return;
+    }
+
+    //*** latest check-in is the family at the scale ***
+    haveFamily_ = true;
+    currentKey_ = checkIn.key;
+    currentDay_ = checkIn.day;
+
+    printf( "ScaleServer: family %d (%s), %d items\n", checkIn.key, checkIn.name, checkIn.numItems );
+
+    if ( checkInHandler_ ) checkInHandler_();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handleAck
+ * @param frame
+ */
+//*****************************************************************************
+void ScaleServer::handleAck( const char *frame, size_t )
+{
+t_WeightAck ack;
+
+    memcpy( &ack, frame, sizeof(ack) );
+
+    //*** ack for an earlier run ***
+    if ( ack.session != session_ ) return;
+
+    //*** cumulative - everything up to seq is stored ***
+    while ( !unacked_.empty() && unacked_.front().seq <= ack.seq )
+    {
+        unacked_.pop_front();
+        pumpPending_ = true;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handleCommand
+ * @param frame
+ */
+//*****************************************************************************
+void ScaleServer::handleCommand( const char *frame, size_t )
+{
+t_ScaleCommand command;
+
+    memcpy( &command, frame, sizeof(command) );
+
+    printf( "ScaleServer: %s command (%.2f)\n", findMsgType( command.type )->name, command.value );
+
+    if ( !commandHandler_ )
+    {
+        postResult( command.type, COMMAND_REFUSED, 0.0f );
+        return;
+    }
+
+    //*** the handler answers through postResult() ***
+    commandHandler_( command.type, command.value );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handlePosted
+ */
+//*****************************************************************************
+void ScaleServer::handlePosted()
+{
+uint64_t count;
+std::deque<float> weights;
+std::deque<t_CommandResult> results;
+t_WeightReportSeq report;
+
+    //*** clear the wakeup ***
+    if ( read( eventFd_, &count, sizeof(count) ) < 0 && errno != EAGAIN ) return;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        weights.swap( pending_ );
+        results.swap( results_ );
+    }
+
+    for ( size_t i = 0; i < results.size(); i++ )
+    {
+        sendAll( &results[i], COMMAND_RESULT_SIZE );
+    }
+
+    for ( size_t i = 0; i < weights.size(); i++ )
+    {
+        if ( !haveFamily_ )
+        {
+            printf( "ScaleServer: %.2f with no family checked in, dropped\n", weights[i] );
+            continue;
+        }
+
+        memset( &report, 0, sizeof(report) );
+        report.magic   = MAGIC_VAL;
+        report.size    = WEIGHT_REPORT_SEQ_SIZE - MSG_SIZE_OFFSET;
+        report.type    = WEIGHT_REPORT_SEQ_TYPE;
+        report.key     = currentKey_;
+        report.weight  = weights[i];
+        report.day     = currentDay_;
+        report.session = session_;
+        report.seq     = nextSeq_++;
+
+        unacked_.push_back( report );
+
+        //*** nobody acking for a long time - oldest is lost ***
+        if ( unacked_.size() > MAX_UNACKED )
+        {
+            printf( "ScaleServer: %u unacked, dropped seq %u (%.2f)\n", (unsigned)MAX_UNACKED,
+                    unacked_.front().seq, unacked_.front().weight );
+            unacked_.pop_front();
+        }
+
+        pumpPending_ = true;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handleLiveTimer
+ */
+//*****************************************************************************
+void ScaleServer::handleLiveTimer()
+{
+uint64_t expirations;
+
+    if ( read( timerFd_, &expirations, sizeof(expirations) ) < 0 ) return;
+
+    //*** one frame however late we are - missed ticks are not made up ***
+    live_->publish( liveSource_(), haveFamily_ ? currentKey_ : 0 );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::handleHeartbeat
+ */
+//*****************************************************************************
+void ScaleServer::handleHeartbeat()
+{
+uint64_t expirations;
+t_Heartbeat beat;
+
+    if ( read( heartbeatFd_, &expirations, sizeof(expirations) ) < 0 ) return;
+
+    memset( &beat, 0, sizeof(beat) );
+    beat.magic   = MAGIC_VAL;
+    beat.size    = HEARTBEAT_SIZE - MSG_SIZE_OFFSET;
+    beat.type    = HEARTBEAT_TYPE;
+    beat.session = session_;
+    beat.lastSeq = nextSeq_ - 1;
+
+    sendAll( &beat, HEARTBEAT_SIZE );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::pumpClient
+ * @param client
+ * @return - FALSE if the client should be closed
+ */
+//*****************************************************************************
+bool ScaleServer::pumpClient( t_Client &client )
+{
+    if ( unacked_.empty() ) return true;
+
+    //*** seq numbers in unacked_ are contiguous ***
+    uint32_t first = unacked_.front().seq;
+    uint32_t last  = first + window_ - 1;
+
+    //*** new client, or acked past what it was sent ***
+    if ( client.sentSeq < first - 1 ) client.sentSeq = first - 1;
+
+    size_t begin = client.sentSeq + 1 - first;
+    size_t end   = begin;
+
+    while ( end < unacked_.size() && unacked_[end].seq <= last ) end++;
+
+    if ( end == begin ) return true;
+
+    //*** one report on its own, more (a backlog) in as few frames as possible ***
+    while ( begin < end )
+    {
+        size_t num = std::min( end - begin, (size_t)WEIGHT_BATCH_MAX );
+
+        if ( num == 1 )
+        {
+            client.out.append( (const char *)&unacked_[begin], WEIGHT_REPORT_SEQ_SIZE );
+        }
+        else
+        {
+            t_WeightBatch batch;
+            t_BatchEntry  entry;
+
+            memset( &batch, 0, sizeof(batch) );
+            batch.magic   = MAGIC_VAL;
+            batch.size    = WEIGHT_BATCH_SIZE + num * BATCH_ENTRY_SIZE - MSG_SIZE_OFFSET;
+            batch.type    = WEIGHT_BATCH_TYPE;
+            batch.session = session_;
+            batch.count   = num;
+
+            client.out.append( (const char *)&batch, WEIGHT_BATCH_SIZE );
+
+            for ( size_t i = begin; i < begin + num; i++ )
+            {
+                memset( &entry, 0, sizeof(entry) );
+                entry.key    = unacked_[i].key;
+                entry.weight = unacked_[i].weight;
+                entry.day    = unacked_[i].day;
+                entry.seq    = unacked_[i].seq;
+
+                client.out.append( (const char *)&entry, BATCH_ENTRY_SIZE );
+            }
+        }
+
+        begin += num;
+    }
+
+    client.sentSeq = unacked_[end - 1].seq;
+
+    return flushClient( client );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::pumpAll
+ */
+//*****************************************************************************
+void ScaleServer::pumpAll()
+{
+std::deque<int> dead;
+
+    pumpPending_ = false;
+
+    for ( std::map<int,t_Client>::iterator it = clients_.begin(); it != clients_.end(); ++it )
+    {
+        if ( !pumpClient( it->second ) ) dead.push_back( it->first );
+    }
+
+    for ( size_t i = 0; i < dead.size(); i++ )
+    {
+        closeClient( dead[i] );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief ScaleServer::sendAll
+ * @param msg
+ * @param size
+ */
+//*****************************************************************************
+void ScaleServer::sendAll( const void *msg, size_t size )
+{
+std::deque<int> dead;
+
+    for ( std::map<int,t_Client>::iterator it = clients_.begin(); it != clients_.end(); ++it )
+    {
+        it->second.out.append( (const char *)msg, size );
+
+        if ( !flushClient( it->second ) ) dead.push_back( it->first );
+    }
+
+    for ( size_t i = 0; i < dead.size(); i++ )
+    {
+        closeClient( dead[i] );
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef SCALESERVER_H
+#define SCALESERVER_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+#include "FpMessages.h"
+
+class LivePublisher;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The ScaleServer class
+ *
+ * Scale side of the fpSvr link. An epoll loop accepts fpSvr connections, reads
+ * the relayed t_CheckIn stream to track the family at the scale, and sends a
+ * t_WeightReportSeq for each settled weight. Reports are kept until fpSvr
+ * acknowledges them; up to 'window' are in flight at once and the rest are
+ * resent to any client that (re)connects. When more than one report is due
+ * they go out as a t_WeightBatch. Weights are posted from the sampler thread
+ * and handed to the loop through an eventfd, so sampling never waits on the
+ * network. A heartbeat goes to every client from a timerfd, and the live
+ * weight is multicast from another in the same loop. Tare / calibrate /
+ * sleep / wake commands are passed to the command handler, and results posted back are
+ * sent to every client. SIGINT / SIGTERM stop the loop (block them before
+ * starting any threads).
+ */
+//*****************************************************************************
+class ScaleServer
+{
+public:
+
+    //*** called on the loop thread with each tare / calibrate / sleep / wake command ***
+    typedef std::function<void(uint32_t type, float value)> CommandFn;
+
+    //*** called on the loop thread when a family checks in ***
+    typedef std::function<void()> CheckInFn;
+
+    //*** constructor ***
+    ScaleServer();
+
+    //*** destructor ***
+    ~ScaleServer();
+
+    //*** opens the listen socket and event loop ***
+    bool start( uint16_t port, int window );
+
+    //*** publishes the live weight from source() rateHz times a second ***
+    bool startLive( LivePublisher *publisher, std::function<float()> source, int rateHz );
+
+    //*** runs the event loop until a stop signal ***
+    void run();
+
+    //*** queues a settled weight for the current family (any thread) ***
+    void postWeight( float weight );
+
+    //*** handler for commands from fpSvr, none refuses them ***
+    void setCommandHandler( CommandFn handler ) { commandHandler_ = handler; }
+
+    //*** handler for check-ins (with items) ***
+    void setCheckInHandler( CheckInFn handler ) { checkInHandler_ = handler; }
+
+    //*** queues the result of a command for every client (any thread) ***
+    void postResult( uint32_t command, int32_t status, float value );
+
+private:
+
+    //*** one fpSvr connection ***
+    typedef struct
+    {
+        int         fd;
+        std::string in;      // partial check-in
+        std::string out;     // unsent reports
+        bool        wantOut; // EPOLLOUT registered
+        uint32_t    sentSeq; // last report sent to this client
+    } t_Client;
+
+    //*** loop handlers ***
+    void acceptClients();
+    bool readClient( t_Client &client );
+    bool flushClient( t_Client &client );
+    void closeClient( int fd );
+    void handleCheckIn( const t_CheckIn &checkIn );
+    void handlePosted();
+    void handleLiveTimer();
+    void handleHeartbeat();
+
+    //*** framed messages from a client, by type ***
+    typedef void (ScaleServer::*FrameHandler)( const char *frame, size_t size );
+
+    typedef struct
+    {
+        uint32_t     type;
+        FrameHandler handler;
+    } t_FrameHandler;
+
+    static const t_FrameHandler frameHandlers_[];
+
+    void handleAck( const char *frame, size_t size );
+    void handleCommand( const char *frame, size_t size );
+
+    //*** sends unacked reports, within the window, to a client ***
+    bool pumpClient( t_Client &client );
+    void pumpAll();
+
+    //*** queues a message for every client ***
+    void sendAll( const void *msg, size_t size );
+
+    int listenFd_;
+    int epollFd_;
+    int eventFd_;
+    int signalFd_;
+    int timerFd_;
+    int heartbeatFd_;
+
+    //*** live weight ***
+    LivePublisher          *live_;
+    std::function<float()>  liveSource_;
+
+    std::map<int,t_Client> clients_;
+
+    //*** family at the scale ***
+    bool    haveFamily_;
+    int32_t currentKey_;
+    int64_t currentDay_;
+
+    //*** reports not yet acknowledged, oldest first ***
+    uint32_t                      session_;
+    uint32_t                      nextSeq_;
+    int                           window_;
+    std::deque<t_WeightReportSeq> unacked_;
+    bool                          pumpPending_;
+
+    //*** tare / calibrate / sleep / wake, and check-ins ***
+    CommandFn commandHandler_;
+    CheckInFn checkInHandler_;
+
+    //*** weights from the sampler thread, command results ***
+    std::mutex                  mutex_;
+    std::deque<float>           pending_;
+    std::deque<t_CommandResult> results_;
+};
+
+#endif // SCALESERVER_H
@@ -0,0 +1,64 @@
+#include "SettleDetector.h"
+
+#include <math.h>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SettleDetector::SettleDetector
+ * @param settings
+ */
+//*****************************************************************************
+SettleDetector::SettleDetector( const t_SettleSettings &settings )
+{
+    settings_ = settings;
+
+    armed_ = true;
+    inRow_ = 0;
+    last_  = 0.0f;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SettleDetector::add
+ * @param weight
+ * @return
+ */
+//*****************************************************************************
+bool SettleDetector::add( float weight )
+{
+    //*** already reported - wait for the platform to be emptied ***
+    if ( !armed_ )
+    {
+        if ( weight < settings_.emptyWeight ) armed_ = true;
+        return false;
+    }
+
+    if ( weight < settings_.minWeight )
+    {
+        inRow_ = 0;
+        return false;
+    }
+
+    //*** count readings in a row within tolerance ***
+    if ( inRow_ > 0 && fabs( weight - last_ ) <= settings_.tolerance )
+    {
+        inRow_++;
+    }
+    else
+    {
+        inRow_ = 1;
+    }
+
+    last_ = weight;
+
+    if ( inRow_ < settings_.settleCount ) return false;
+
+    armed_ = false;
+    inRow_ = 0;
+
+    return true;
+}
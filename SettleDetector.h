@@ -0,0 +1,49 @@
+#ifndef SETTLEDETECTOR_H
+#define SETTLEDETECTOR_H
+
+
+//*** settled weight detection ***
+typedef struct
+{
+    float minWeight;     // weights below this are ignored
+    float emptyWeight;   // platform must drop below this before the next weight
+    float tolerance;     // max change between readings to count as settled
+    int   settleCount;   // readings in a row within tolerance
+} t_SettleSettings;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The SettleDetector class
+ *
+ * Picks settled weights out of a stream of readings. A weight is settled
+ * once settleCount readings in a row are within tolerance of each other,
+ * and the next one is only picked after the platform has been emptied.
+ * Has no hardware dependencies, so recorded readings can be run through
+ * it offline.
+ */
+//*****************************************************************************
+class SettleDetector
+{
+public:
+
+    //*** constructor ***
+    explicit SettleDetector( const t_SettleSettings &settings );
+
+    //*** next reading - TRUE if it is a settled weight to report ***
+    bool add( float weight );
+
+    //*** readings so far don't count towards settling ***
+    void restart() { inRow_ = 0; }
+
+private:
+
+    t_SettleSettings settings_;
+
+    bool  armed_;
+    int   inRow_;
+    float last_;
+};
+
+#endif // SETTLEDETECTOR_H
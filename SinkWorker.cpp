@@ -0,0 +1,500 @@
+#include "SinkWorker.h"
+
+#include <QMetaObject>
+#include <QTimer>
+
+
+//*** reopen backoff ***
+const int RETRY_MIN_MS = 2000;
+const int RETRY_MAX_MS = 60000;
+
+//*** writes of one weight that fail with the sink still up, before it is dead lettered ***
+const int MAX_WRITE_RETRIES = 5;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::SinkWorker
+ * @param sink
+ * @param maxQueue
+ * @param probeMs
+ * @param deadLetterPath
+ * @param acks
+ */
+//*****************************************************************************
+SinkWorker::SinkWorker( WeightSink *sink, int maxQueue, int probeMs, QString deadLetterPath, bool acks ) : QObject(Q_NULLPTR)
+{
+    sink_         = sink;
+    deadLetter_   = deadLetterPath.isEmpty() ? Q_NULLPTR : new CsvSink( sink->name() + " dead letter", deadLetterPath );
+    acks_         = acks;
+    maxQueue_     = maxQueue;
+    drainPending_ = false;
+    ready_        = 0;
+
+    superviseTimer_  = Q_NULLPTR;
+    writeRetryTimer_ = Q_NULLPTR;
+    flushTimer_      = Q_NULLPTR;
+    probeMs_         = probeMs;
+    retryMs_         = RETRY_MIN_MS;
+    writeRetryMs_    = RETRY_MIN_MS;
+    writeFailures_   = 0;
+
+    //*** everything for this sink runs on its own thread ***
+    moveToThread( &thread_ );
+
+    connect( &thread_, SIGNAL(started()), SLOT(handleOpen()) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::~SinkWorker
+ */
+//*****************************************************************************
+SinkWorker::~SinkWorker()
+{
+    if ( thread_.isRunning() )
+    {
+        //*** sink (and its connection) is closed on its own thread ***
+        QMetaObject::invokeMethod( this, "handleClose", Qt::BlockingQueuedConnection );
+
+        thread_.quit();
+        thread_.wait();
+    }
+    else
+    {
+        delete sink_;
+        delete deadLetter_;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::start
+ */
+//*****************************************************************************
+void SinkWorker::start()
+{
+    thread_.setObjectName( sink_->name() );
+    thread_.start();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::post
+ * @param entry
+ */
+//*****************************************************************************
+void SinkWorker::post( const t_WeightEntry &entry )
+{
+bool wake = false;
+bool dropped = false;
+
+    {
+        QMutexLocker lock( &mutex_ );
+
+        //*** bounded - drop the oldest that the scale won't resend ***
+        if ( queue_.size() >= maxQueue_ )
+        {
+            dropped = dropOldest();
+        }
+
+        queue_.enqueue( entry );
+
+        //*** only one drain request outstanding ***
+        if ( !drainPending_ )
+        {
+            drainPending_ = true;
+            wake = true;
+        }
+    }
+
+    if ( dropped )
+    {
+        emit writeFailed( QString( "%1 : queue full, oldest weight dropped" ).arg( sink_->name() ) );
+    }
+
+    if ( wake )
+    {
+        QMetaObject::invokeMethod( this, "drain", Qt::QueuedConnection );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::handleOpen
+ */
+//*****************************************************************************
+void SinkWorker::handleOpen()
+{
+    //*** created here so it lives on the worker thread ***
+    superviseTimer_ = new QTimer( this );
+    superviseTimer_->setSingleShot( true );
+    connect( superviseTimer_, SIGNAL(timeout()), SLOT(supervise()) );
+
+    writeRetryTimer_ = new QTimer( this );
+    writeRetryTimer_->setSingleShot( true );
+    connect( writeRetryTimer_, SIGNAL(timeout()), SLOT(drain()) );
+
+    flushTimer_ = new QTimer( this );
+    flushTimer_->setSingleShot( true );
+    connect( flushTimer_, SIGNAL(timeout()), SLOT(handleFlush()) );
+
+    bool ok = sink_->open();
+
+    setReady( ok, ok ? QString() : sink_->lastError(), true );
+
+    scheduleSupervise();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::supervise
+ */
+//*****************************************************************************
+void SinkWorker::supervise()
+{
+    if ( !sink_ ) return;
+
+    if ( isReady() )
+    {
+        if ( !sink_->probe() ) setReady( false, sink_->lastError() );
+    }
+    else if ( sink_->reopen() )
+    {
+        setReady( true, QString() );
+
+        //*** write what was held while it was down ***
+        drain();
+        scheduleFlush();
+    }
+    else
+    {
+        //*** still down - back off ***
+        retryMs_ = qMin( retryMs_ * 2, RETRY_MAX_MS );
+    }
+
+    scheduleSupervise();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::scheduleSupervise
+ */
+//*****************************************************************************
+void SinkWorker::scheduleSupervise()
+{
+    if ( !superviseTimer_ ) return;
+
+    if ( isReady() )
+    {
+        retryMs_ = RETRY_MIN_MS;
+
+        //*** 0 turns probing off ***
+        if ( probeMs_ <= 0 ) return;
+
+        superviseTimer_->start( probeMs_ );
+    }
+    else
+    {
+        superviseTimer_->start( retryMs_ );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::scheduleFlush
+ */
+//*****************************************************************************
+void SinkWorker::scheduleFlush()
+{
+    //*** from the first weight held, later ones don't push it back ***
+    if ( !flushTimer_ || flushTimer_->isActive() || !sink_->hasPending() ) return;
+
+    flushTimer_->start( sink_->flushDelayMs() );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::handleFlush
+ */
+//*****************************************************************************
+void SinkWorker::handleFlush()
+{
+    //*** down - kept by the sink, flushed after the reopen ***
+    if ( !sink_ || !isReady() ) return;
+
+    if ( sink_->flush() ) return;
+
+    emit writeFailed( QString( "%1 : %2" ).arg( sink_->name() ).arg( sink_->lastError() ) );
+
+    if ( !sink_->probe() )
+    {
+        setReady( false, sink_->lastError() );
+        scheduleSupervise();
+    }
+    else
+    {
+        //*** still up - try again later ***
+        scheduleFlush();
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::setReady
+ * @param ready
+ * @param error
+ * @param force
+ */
+//*****************************************************************************
+void SinkWorker::setReady( bool ready, QString error, bool force )
+{
+    bool was = ( ready_.fetchAndStoreOrdered( ready ? 1 : 0 ) != 0 );
+
+    if ( force || was != ready )
+    {
+        emit opened( ready, error );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::requeue
+ * @param pending
+ */
+//*****************************************************************************
+void SinkWorker::requeue( QQueue<t_WeightEntry> &pending )
+{
+int numDropped = 0;
+
+    {
+        QMutexLocker lock( &mutex_ );
+
+        //*** ahead of anything posted since ***
+        pending.append( queue_ );
+        queue_.swap( pending );
+
+        //*** still bounded - drop the oldest the scale won't resend ***
+        while ( queue_.size() > maxQueue_ && dropOldest() )
+        {
+            numDropped++;
+        }
+    }
+
+    if ( numDropped )
+    {
+        emit writeFailed( QString( "%1 : queue full, %2 weight(s) dropped" ).arg( sink_->name() ).arg( numDropped ) );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::dropOldest
+ * @return
+ */
+//*****************************************************************************
+bool SinkWorker::dropOldest()
+{
+    //*** the scale resends sequenced weights until acked, they are never dropped ***
+    for ( int i=0; i<queue_.size(); i++ )
+    {
+        if ( !queue_.at( i ).seq )
+        {
+            queue_.removeAt( i );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::deadLetter
+ * @param entry
+ * @return
+ */
+//*****************************************************************************
+bool SinkWorker::deadLetter( const t_WeightEntry &entry )
+{
+    if ( !deadLetter_ ) return false;
+
+    //*** opened on first use, and again after a failure ***
+    if ( !deadLetter_->isReady() && !deadLetter_->open() ) return false;
+
+    if ( !deadLetter_->write( entry ) )
+    {
+        deadLetter_->reopen();
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::handleClose
+ */
+//*****************************************************************************
+void SinkWorker::handleClose()
+{
+    //*** last chance for anything held ***
+    if ( isReady() && !sink_->flush() )
+    {
+        emit writeFailed( QString( "%1 : %2" ).arg( sink_->name() ).arg( sink_->lastError() ) );
+    }
+
+    ready_.storeRelease( 0 );
+
+    //*** timers belong to this thread ***
+    delete superviseTimer_;
+    superviseTimer_ = Q_NULLPTR;
+
+    delete writeRetryTimer_;
+    writeRetryTimer_ = Q_NULLPTR;
+
+    delete flushTimer_;
+    flushTimer_ = Q_NULLPTR;
+
+    delete sink_;
+    sink_ = Q_NULLPTR;
+
+    delete deadLetter_;
+    deadLetter_ = Q_NULLPTR;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief SinkWorker::drain
+ */
+//*****************************************************************************
+void SinkWorker::drain()
+{
+QQueue<t_WeightEntry> pending;
+quint32 session = 0;
+quint32 seq = 0;
+bool failed = false;
+
+    //*** take everything queued so far ***
+    {
+        QMutexLocker lock( &mutex_ );
+        pending.swap( queue_ );
+        drainPending_ = false;
+    }
+
+    if ( !sink_ ) return;
+
+    //*** nothing acks for this sink, so nothing bounds it while it is down - the ***
+    //*** oldest past the depth (all sequenced by now) go to the dead letter file ***
+    if ( !acks_ && pending.size() > maxQueue_ )
+    {
+        int numSpilled = 0;
+        int numLost    = 0;
+
+        while ( pending.size() > maxQueue_ )
+        {
+            if ( deadLetter( pending.dequeue() ) ) numSpilled++; else numLost++;
+        }
+
+        if ( numSpilled ) emit writeFailed( QString( "%1 : queue full, %2 weight(s) moved to the dead letter file" ).arg( sink_->name() ).arg( numSpilled ) );
+        if ( numLost )    emit writeFailed( QString( "%1 : queue full, %2 weight(s) dropped" ).arg( sink_->name() ).arg( numLost ) );
+    }
+
+    //*** sink down, or backing off a failed write - hold everything ***
+    if ( !isReady() || ( writeRetryTimer_ && writeRetryTimer_->isActive() ) )
+    {
+        requeue( pending );
+        return;
+    }
+
+    while ( !pending.isEmpty() )
+    {
+        const t_WeightEntry &entry = pending.head();
+
+        //*** keep this weight and the rest - acks are cumulative, so skipping ***
+        //*** one would leave a gap that stops them for the session            ***
+        if ( !sink_->write( entry ) )
+        {
+            bool up = sink_->probe();
+
+            if ( up && ++writeFailures_ >= MAX_WRITE_RETRIES )
+            {
+                //*** still up but won't take this one - out of the way, and counted as written ***
+                bool kept = deadLetter( entry );
+
+                emit writeFailed( QString( "%1 : %2, weight for %3 %4" ).arg( sink_->name() ).arg( sink_->lastError() )
+                                  .arg( entry.key ).arg( kept ? "moved to the dead letter file" : "dropped" ) );
+            }
+            else
+            {
+                if ( !up )
+                {
+                    //*** connection lost - written after the reopen ***
+                    setReady( false, sink_->lastError() );
+                    scheduleSupervise();
+
+                    writeFailures_ = 0;
+                }
+                else
+                {
+                    //*** still up - try the same weight again, backing off ***
+                    emit writeFailed( QString( "%1 : %2, retry in %3 ms" ).arg( sink_->name() ).arg( sink_->lastError() ).arg( writeRetryMs_ ) );
+
+                    writeRetryTimer_->start( writeRetryMs_ );
+                    writeRetryMs_ = qMin( writeRetryMs_ * 2, RETRY_MAX_MS );
+                }
+
+                requeue( pending );
+                failed = true;
+                break;
+            }
+        }
+
+        writeFailures_ = 0;
+
+        if ( entry.seq )
+        {
+            session = entry.session;
+            seq     = entry.seq;
+        }
+
+        pending.dequeue();
+    }
+
+    //*** all written ***
+    if ( !failed ) writeRetryMs_ = RETRY_MIN_MS;
+
+    //*** one commit notice per batch ***
+    if ( seq ) emit committed( session, seq );
+
+    scheduleFlush();
+}
@@ -0,0 +1,131 @@
+#ifndef SINKWORKER_H
+#define SINKWORKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QQueue>
+#include <QAtomicInt>
+
+class QTimer;
+
+#include "WeightSink.h"
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The SinkWorker class
+ *
+ * Owns one WeightSink and its thread. Weights are posted from any thread into
+ * a bounded queue and written on the worker thread, so a slow sink never holds
+ * up the others or the caller. When the queue is full the oldest unsequenced
+ * weight is dropped. Sequenced weights are not dropped: for the sink that
+ * acks, the scale's window bounds them, and other sinks move the oldest past
+ * the depth to their dead letter file. A write that fails while the sink is
+ * still up is retried MAX_WRITE_RETRIES times, then the weight goes to the
+ * dead letter file and counts as written, so one bad weight can't stop the
+ * acks.
+ *
+ * The worker also supervises the sink: a sink that fails to open, or fails a
+ * probe, is reopened with backoff, and weights are held in the queue until it
+ * is back. Weights a sink holds back to coalesce are flushed when it asks,
+ * and before it is closed.
+ */
+//*****************************************************************************
+class SinkWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor - takes ownership of the sink, probes it every probeMs while ready. ***
+    //*** 'acks' if its commits ack the scale, deadLetterPath empty - weights are dropped ***
+    explicit SinkWorker( WeightSink *sink, int maxQueue, int probeMs, QString deadLetterPath, bool acks );
+
+    //*** destructor - closes the sink and stops the thread ***
+    ~SinkWorker();
+
+    //*** starts the thread, the sink is opened on it ***
+    void start();
+
+    //*** if TRUE, sink opened and ready ***
+    bool isReady() { return ready_.loadAcquire() != 0; }
+
+    //*** the sink (only use thread safe parts from other threads) ***
+    WeightSink *sink() { return sink_; }
+
+    //*** queues a weight for the sink (any thread) ***
+    void post( const t_WeightEntry &entry );
+
+signals:
+
+    //*** sink open finished, or the sink was lost / restored since ***
+    void opened( bool ok, QString error );
+
+    //*** write failed (it is retried), or a weight was dropped ***
+    void writeFailed( QString error );
+
+    //*** sequenced weights up to seq are written (once per drain) ***
+    void committed( quint32 session, quint32 seq );
+
+private slots:
+
+    //*** run on the worker thread ***
+    void handleOpen();
+    void handleClose();
+    void drain();
+
+    //*** probe when ready, reopen when not ***
+    void supervise();
+
+    //*** writes what the sink is holding ***
+    void handleFlush();
+
+private:
+
+    //*** sets the ready flag, emits opened() on a change (or always if forced) ***
+    void setReady( bool ready, QString error, bool force = false );
+
+    //*** puts unwritten weights back at the head of the queue ***
+    void requeue( QQueue<t_WeightEntry> &pending );
+
+    //*** drops the oldest unsequenced weight, FALSE if there is none (mutex_ held) ***
+    bool dropOldest();
+
+    //*** writes a weight the sink can't take to the dead letter file, FALSE if it is lost ***
+    bool deadLetter( const t_WeightEntry &entry );
+
+    //*** starts the timer for the next probe or reopen ***
+    void scheduleSupervise();
+
+    //*** starts the flush timer if the sink is holding weights ***
+    void scheduleFlush();
+
+    QThread thread_;
+
+    WeightSink *sink_;
+
+    //*** weights written to the sink in name only (worker thread), NULL for none ***
+    CsvSink *deadLetter_;
+    bool     acks_;
+
+    //*** pending weights ***
+    QMutex                 mutex_;
+    QQueue<t_WeightEntry>  queue_;
+    int                    maxQueue_;
+    bool                   drainPending_;
+
+    QAtomicInt ready_;
+
+    //*** supervision, write retries and flushing (worker thread only) ***
+    QTimer *superviseTimer_;
+    QTimer *writeRetryTimer_;
+    QTimer *flushTimer_;
+    int     probeMs_;
+    int     retryMs_;
+    int     writeRetryMs_;
+    int     writeFailures_;
+};
+
+#endif // SINKWORKER_H
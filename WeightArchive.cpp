@@ -0,0 +1,716 @@
+#include "WeightArchive.h"
+#include "FPDB.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtEndian>
+#include <QDebug>
+
+#include <algorithm>
+
+
+//*****************
+//*** CONSTANTS ***
+//*****************
+const quint32 ARCHIVE_INDEX_MAGIC   = 0x46504149;     // 'FPAI'
+const quint32 ARCHIVE_INDEX_VERSION = 2;             // 2 - framed data blocks
+
+//*** every data block is preceded by magic and length (big endian) ***
+const quint32 ARCHIVE_BLOCK_MAGIC   = 0x46504142;     // 'FPAB'
+const int     ARCHIVE_FRAME_SIZE    = 8;
+
+//*** weights are stored as fixed point hundredths ***
+const double WEIGHT_SCALE = 100.0;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief putVarint - appends an unsigned LEB128 varint
+ */
+//*****************************************************************************
+static void putVarint( QByteArray &buf, quint32 val )
+{
+    while ( val >= 0x80 )
+    {
+        buf.append( (char)( (val & 0x7F) | 0x80 ) );
+        val >>= 7;
+    }
+    buf.append( (char)val );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief getVarint - reads an unsigned LEB128 varint, advancing 'p'
+ */
+//*****************************************************************************
+static bool getVarint( const uchar *&p, const uchar *end, quint32 &val )
+{
+int shift = 0;
+
+    val = 0;
+
+    while ( p < end && shift < 35 )
+    {
+        uchar b = *p++;
+        val |= (quint32)( b & 0x7F ) << shift;
+        if ( (b & 0x80) == 0 ) return true;
+        shift += 7;
+    }
+
+    return false;
+}
+
+
+//*** zigzag mapping of signed values so small magnitudes stay short ***
+static quint32 zigzag( qint32 val )   { return ( (quint32)val << 1 ) ^ (quint32)( val >> 31 ); }
+static qint32  unzigzag( quint32 val ) { return (qint32)( val >> 1 ) ^ -(qint32)( val & 1 ); }
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::WeightArchive
+ * @param path
+ * @param parent
+ */
+//*****************************************************************************
+WeightArchive::WeightArchive( QString path, QObject *parent ) : QObject(parent), mutex_( QMutex::Recursive )
+{
+    path_       = path;
+    isReady_    = false;
+    lastError_  = "No error";
+    coveredDay_ = -1;
+
+    //*** make sure the archive directory exists ***
+    if ( !QDir().mkpath( path_ ) )
+    {
+        lastError_ = "Unable to create archive directory " + path_;
+        return;
+    }
+
+    //*** a bad index is rebuilt from the data blocks ***
+    isReady_ = loadIndex() || rebuildIndex();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::rollover
+ * @param db
+ * @return
+ */
+//*****************************************************************************
+int WeightArchive::rollover( FPDB *db )
+{
+int numArchived = 0;
+QVector<t_WeightRec> recs;
+t_DayColumns cols;
+int idx;
+
+    //*** sanity check ***
+    if ( !isReady_ || !db || !db->isReady() ) return -1;
+
+    QMutexLocker lock( &mutex_ );
+
+    //*** only closed days (before today) are archived ***
+    qint64 today = QDate::currentDate().toJulianDay();
+
+    //*** a late weight lowers this while we run, and then it is left alone ***
+    int covered = coveredDay_.loadAcquire();
+
+    QVector<t_DayTotal> days = db->getDayTotals( today );
+
+    for ( const t_DayTotal &day : days )
+    {
+        //*** archived and no rows added since (rows are never updated) ***
+        idx = findDay( day.day );
+        if ( idx >= 0 && index_[idx].count == (quint32)day.count ) continue;
+
+        if ( !db->getDayRecords( day.day, recs ) )
+        {
+            lastError_ = db->lastError();
+            numArchived = -1;
+            break;
+        }
+
+        //*** split records into columns ***
+        cols.famId.resize( recs.size() );
+        cols.weight.resize( recs.size() );
+        cols.recId.resize( recs.size() );
+
+        for ( int i=0; i<recs.size(); i++ )
+        {
+            cols.famId[i]  = recs[i].famId;
+            cols.weight[i] = qRound( recs[i].weight * WEIGHT_SCALE );
+            cols.recId[i]  = recs[i].recId;
+        }
+
+        if ( !appendDay( day.day, cols ) )
+        {
+            numArchived = -1;
+            break;
+        }
+
+        numArchived++;
+    }
+
+    //*** index is only written once the data blocks are out ***
+    if ( numArchived != 0 && !saveIndex() ) return -1;
+
+    if ( numArchived >= 0 )
+    {
+        coveredDay_.testAndSetOrdered( covered, (int)( today - 1 ) );
+    }
+
+    return numArchived;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::markChanged
+ * @param day
+ */
+//*****************************************************************************
+void WeightArchive::markChanged( qint64 day )
+{
+int covered = coveredDay_.loadAcquire();
+
+    //*** only ever lowered here ***
+    while ( day <= covered && !coveredDay_.testAndSetOrdered( covered, (int)( day - 1 ) ) )
+    {
+        covered = coveredDay_.loadAcquire();
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::getTotal
+ * @param firstDay
+ * @param lastDay
+ * @param famId
+ * @return
+ */
+//*****************************************************************************
+t_WeightTotal WeightArchive::getTotal( qint64 firstDay, qint64 lastDay, qint32 famId )
+{
+t_WeightTotal total = { 0, 0.0 };
+t_DayColumns cols;
+qint64 weight = 0;
+int first, last;
+
+    QMutexLocker lock( &mutex_ );
+
+    findRange( firstDay, lastDay, first, last );
+
+    for ( int i=first; i<=last; i++ )
+    {
+        //*** all families - index has the answer ***
+        if ( famId == ALL_FAMILIES )
+        {
+            total.count  += index_[i].count;
+            total.weight += index_[i].weight;
+            continue;
+        }
+
+        //*** single family - scan the family column for the day ***
+        if ( !readDay( index_[i], cols ) ) continue;
+
+        for ( int j=0; j<cols.famId.size(); j++ )
+        {
+            if ( cols.famId[j] == famId )
+            {
+                total.count++;
+                weight += cols.weight[j];
+            }
+        }
+    }
+
+    //*** convert from fixed point ***
+    if ( famId != ALL_FAMILIES )
+    {
+        total.weight = (double)weight / WEIGHT_SCALE;
+    }
+
+    return total;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::getFamilyTotals
+ * @param firstDay
+ * @param lastDay
+ * @return
+ */
+//*****************************************************************************
+QMap<qint32,t_WeightTotal> WeightArchive::getFamilyTotals( qint64 firstDay, qint64 lastDay )
+{
+QMap<qint32,t_WeightTotal> totals;
+QMap<qint32,qint64> weights;
+t_DayColumns cols;
+int first, last;
+
+    QMutexLocker lock( &mutex_ );
+
+    findRange( firstDay, lastDay, first, last );
+
+    for ( int i=first; i<=last; i++ )
+    {
+        if ( !readDay( index_[i], cols ) ) continue;
+
+        for ( int j=0; j<cols.famId.size(); j++ )
+        {
+            t_WeightTotal &total = totals[cols.famId[j]];
+            total.count++;
+            weights[cols.famId[j]] += cols.weight[j];
+        }
+    }
+
+    //*** convert from fixed point ***
+    for ( auto it = totals.begin(); it != totals.end(); ++it )
+    {
+        it.value().weight = (double)weights.value( it.key() ) / WEIGHT_SCALE;
+    }
+
+    return totals;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::getFamilyDays
+ * @param famId
+ * @param firstDay
+ * @param lastDay
+ * @return
+ */
+//*****************************************************************************
+QVector<t_DayTotal> WeightArchive::getFamilyDays( qint32 famId, qint64 firstDay, qint64 lastDay )
+{
+QVector<t_DayTotal> days;
+t_DayColumns cols;
+int first, last;
+
+    QMutexLocker lock( &mutex_ );
+
+    findRange( firstDay, lastDay, first, last );
+
+    //*** newest block first, so the days come out most recent first ***
+    for ( int i=last; i>=first; i-- )
+    {
+        t_DayTotal day = { index_[i].day, 0, 0.0 };
+        qint64 weight = 0;
+
+        if ( !readDay( index_[i], cols ) ) continue;
+
+        for ( int j=0; j<cols.famId.size(); j++ )
+        {
+            if ( cols.famId[j] == famId )
+            {
+                day.count++;
+                weight += cols.weight[j];
+            }
+        }
+
+        if ( !day.count ) continue;
+
+        day.weight = (double)weight / WEIGHT_SCALE;
+        days.append( day );
+    }
+
+    return days;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::loadIndex
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::loadIndex()
+{
+QFile file( path_ + "/" + ArchiveIndexFile );
+quint32 magic, version, count;
+t_ArchiveIndexEntry entry;
+
+    index_.clear();
+
+    //*** no index yet - empty archive ***
+    if ( !file.exists() ) return true;
+
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_5_0 );
+
+    in >> magic >> version >> count;
+
+    if ( magic != ARCHIVE_INDEX_MAGIC || version != ARCHIVE_INDEX_VERSION )
+    {
+        lastError_ = "Invalid archive index " + file.fileName();
+        return false;
+    }
+
+    index_.reserve( count );
+
+    for ( quint32 i=0; i<count; i++ )
+    {
+        in >> entry.day >> entry.offset >> entry.length >> entry.count >> entry.weight;
+        index_.append( entry );
+    }
+
+    if ( in.status() != QDataStream::Ok )
+    {
+        lastError_ = "Truncated archive index " + file.fileName();
+        index_.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::saveIndex
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::saveIndex()
+{
+QSaveFile file( path_ + "/" + ArchiveIndexFile );
+
+    if ( !file.open( QIODevice::WriteOnly ) )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    QDataStream out( &file );
+    out.setVersion( QDataStream::Qt_5_0 );
+
+    out << ARCHIVE_INDEX_MAGIC << ARCHIVE_INDEX_VERSION << (quint32)index_.size();
+
+    for ( const t_ArchiveIndexEntry &entry : index_ )
+    {
+        out << entry.day << entry.offset << entry.length << entry.count << entry.weight;
+    }
+
+    //*** replaces the old index in one step ***
+    if ( !file.commit() )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::rebuildIndex
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::rebuildIndex()
+{
+QFile file( path_ + "/" + ArchiveDataFile );
+uchar frame[ARCHIVE_FRAME_SIZE];
+t_ArchiveIndexEntry entry;
+t_DayColumns cols;
+quint32 day;
+qint64 good = 0;
+qint64 weight;
+
+    index_.clear();
+
+    if ( file.exists() && !file.open( QIODevice::ReadWrite ) )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    //*** blocks in the order written, a day archived again replaces the earlier one ***
+    while ( file.isOpen() && file.read( (char *)frame, ARCHIVE_FRAME_SIZE ) == ARCHIVE_FRAME_SIZE )
+    {
+        if ( qFromBigEndian<quint32>( frame ) != ARCHIVE_BLOCK_MAGIC ) break;
+
+        entry.offset = file.pos();
+        entry.length = qFromBigEndian<quint32>( frame + 4 );
+
+        if ( !decodeDay( file.read( entry.length ), day, cols ) ) break;
+
+        weight = 0;
+        for ( qint32 w : cols.weight ) weight += w;
+
+        entry.day    = day;
+        entry.count  = (quint32)cols.famId.size();
+        entry.weight = (double)weight / WEIGHT_SCALE;
+
+        int idx = findDay( entry.day );
+        if ( idx >= 0 )
+        {
+            index_[idx] = entry;
+        }
+        else
+        {
+            index_.insert( std::lower_bound( index_.begin(), index_.end(), entry.day,
+                                             []( const t_ArchiveIndexEntry &e, qint64 d ) { return e.day < d; } ),
+                           entry );
+        }
+
+        good = file.pos();
+    }
+
+    //*** drop a torn last block (or an unframed old file) - rollover archives those days again ***
+    if ( file.isOpen() && good < file.size() )
+    {
+        qWarning() << "Archive: discarding" << file.size() - good << "bytes after offset" << good;
+
+        if ( !file.resize( good ) )
+        {
+            lastError_ = file.errorString();
+            return false;
+        }
+    }
+
+    return saveIndex();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::appendDay
+ * @param day
+ * @param cols
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::appendDay( qint64 day, const t_DayColumns &cols )
+{
+QFile file( path_ + "/" + ArchiveDataFile );
+QByteArray payload;
+t_ArchiveIndexEntry entry;
+qint64 totalWeight = 0;
+qint32 prev;
+int count = cols.famId.size();
+
+    //*** header ***
+    putVarint( payload, (quint32)day );
+    putVarint( payload, (quint32)count );
+
+    //*** family ID column - delta from previous ***
+    prev = 0;
+    for ( int i=0; i<count; i++ )
+    {
+        putVarint( payload, zigzag( cols.famId[i] - prev ) );
+        prev = cols.famId[i];
+    }
+
+    //*** weight column ***
+    for ( int i=0; i<count; i++ )
+    {
+        putVarint( payload, zigzag( cols.weight[i] ) );
+        totalWeight += cols.weight[i];
+    }
+
+    //*** record ID column - delta from previous (ascending) ***
+    prev = 0;
+    for ( int i=0; i<count; i++ )
+    {
+        putVarint( payload, zigzag( cols.recId[i] - prev ) );
+        prev = cols.recId[i];
+    }
+
+    QByteArray block = qCompress( payload );
+
+    //*** frame, so the index can be rebuilt from the data file ***
+    uchar frame[ARCHIVE_FRAME_SIZE];
+    qToBigEndian( ARCHIVE_BLOCK_MAGIC, frame );
+    qToBigEndian( (quint32)block.size(), frame + 4 );
+
+    //*** append block to the data file ***
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Append ) )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    entry.offset = file.size() + ARCHIVE_FRAME_SIZE;
+
+    if ( file.write( (const char *)frame, ARCHIVE_FRAME_SIZE ) != ARCHIVE_FRAME_SIZE ||
+         file.write( block ) != block.size() || !file.flush() )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    entry.day    = day;
+    entry.length = (quint32)block.size();
+    entry.count  = (quint32)count;
+    entry.weight = (double)totalWeight / WEIGHT_SCALE;
+
+    //*** archived again - the old block is left unreferenced ***
+    int idx = findDay( day );
+    if ( idx >= 0 )
+    {
+        index_[idx] = entry;
+        return true;
+    }
+
+    //*** keep index sorted by day ***
+    auto it = std::lower_bound( index_.begin(), index_.end(), day,
+                                []( const t_ArchiveIndexEntry &e, qint64 d ) { return e.day < d; } );
+    index_.insert( it, entry );
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::readDay
+ * @param entry
+ * @param cols
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::readDay( const t_ArchiveIndexEntry &entry, t_DayColumns &cols )
+{
+QFile file( path_ + "/" + ArchiveDataFile );
+quint32 day;
+
+    if ( !file.open( QIODevice::ReadOnly ) || !file.seek( entry.offset ) )
+    {
+        lastError_ = file.errorString();
+        return false;
+    }
+
+    //*** block must match the index ***
+    if ( !decodeDay( file.read( entry.length ), day, cols ) ||
+         day != (quint32)entry.day || (quint32)cols.famId.size() != entry.count )
+    {
+        lastError_ = QString( "Corrupt archive block for day %1" ).arg( entry.day );
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::decodeDay
+ * @param block
+ * @param day
+ * @param cols
+ * @return
+ */
+//*****************************************************************************
+bool WeightArchive::decodeDay( const QByteArray &block, quint32 &day, t_DayColumns &cols )
+{
+quint32 val, count;
+qint32 prev;
+bool ok = true;
+
+    QByteArray payload = qUncompress( block );
+
+    const uchar *p   = (const uchar *)payload.constData();
+    const uchar *end = p + payload.size();
+
+    //*** header - every value takes at least a byte ***
+    if ( !getVarint( p, end, day ) || !getVarint( p, end, count ) ||
+         count > (quint32)( end - p ) ) return false;
+
+    cols.famId.resize( count );
+    cols.weight.resize( count );
+    cols.recId.resize( count );
+
+    prev = 0;
+    for ( quint32 i=0; ok && i<count; i++ )
+    {
+        ok = getVarint( p, end, val );
+        prev += unzigzag( val );
+        cols.famId[i] = prev;
+    }
+
+    for ( quint32 i=0; ok && i<count; i++ )
+    {
+        ok = getVarint( p, end, val );
+        cols.weight[i] = unzigzag( val );
+    }
+
+    prev = 0;
+    for ( quint32 i=0; ok && i<count; i++ )
+    {
+        ok = getVarint( p, end, val );
+        prev += unzigzag( val );
+        cols.recId[i] = prev;
+    }
+
+    return ok;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::findRange
+ * @param firstDay
+ * @param lastDay
+ * @param first - first index entry in range
+ * @param last - last index entry in range ( < first if none )
+ */
+//*****************************************************************************
+void WeightArchive::findRange( qint64 firstDay, qint64 lastDay, int &first, int &last )
+{
+    auto lo = std::lower_bound( index_.constBegin(), index_.constEnd(), firstDay,
+                                []( const t_ArchiveIndexEntry &e, qint64 d ) { return e.day < d; } );
+    auto hi = std::upper_bound( index_.constBegin(), index_.constEnd(), lastDay,
+                                []( qint64 d, const t_ArchiveIndexEntry &e ) { return d < e.day; } );
+
+    first = (int)( lo - index_.constBegin() );
+    last  = (int)( hi - index_.constBegin() ) - 1;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightArchive::findDay
+ * @param day
+ * @return
+ */
+//*****************************************************************************
+int WeightArchive::findDay( qint64 day )
+{
+int first, last;
+
+    findRange( day, day, first, last );
+
+    return ( first <= last ) ? first : -1;
+}
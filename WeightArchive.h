@@ -0,0 +1,140 @@
+#ifndef WEIGHTARCHIVE_H
+#define WEIGHTARCHIVE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include <QDate>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include "FPDB.h"
+
+
+//**********************************************************
+//******************** Archive Files ***********************
+//**********************************************************
+const QString ArchiveDataFile  = "weights.fpa";
+const QString ArchiveIndexFile = "weights.fpi";
+
+
+//*** one index entry per archived (closed) day ***
+typedef struct
+{
+    qint64  day;        // julian day
+    qint64  offset;     // offset of the day's block in the data file (after its frame)
+    quint32 length;     // length of the (compressed) block
+    quint32 count;      // number of records for the day
+    double  weight;     // total weight for the day
+} t_ArchiveIndexEntry;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The WeightArchive class
+ *
+ * Read optimised copy of closed days from the local weight table. Each day is
+ * stored as one compressed block holding the family ID, weight and record ID
+ * columns (delta / zigzag varint encoded). A small index holding the per day
+ * count and total is kept in memory, so range totals for all families never
+ * touch the data file; a single family's totals decode the family column of
+ * each day in range. FPDB takes the days the archive covers from here for its
+ * statistics and family histories.
+ *
+ * A day whose rows change after it was archived (a late weight) is archived
+ * again on the next rollover, the new block replacing the old one. Blocks are
+ * framed, so a lost or unreadable index is rebuilt from the data file.
+ *
+ * Public functions are thread safe, so rollover() can run on a worker thread.
+ */
+//*****************************************************************************
+class WeightArchive : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor ***
+    explicit WeightArchive( QString path, QObject *parent = nullptr );
+
+    //*** if TRUE, archive index is loaded and ready ***
+    bool isReady() { return isReady_; }
+
+    //*** returns string describing the last error ***
+    QString lastError() { return lastError_; }
+
+    //*** archives all closed days (before today) not yet archived ***
+    //*** returns number of days archived, -1 on error ***
+    int rollover( FPDB *db );
+
+    //*** last day the archive matches the weight table up to, -1 until a rollover completes ***
+    qint64 archivedThrough() { return coveredDay_.loadAcquire(); }
+
+    //*** a record was added for 'day' - not covered again until the next rollover (any thread) ***
+    void markChanged( qint64 day );
+
+    //*** totals for an inclusive range of days, for all families or just one ***
+    t_WeightTotal getTotal( qint64 firstDay, qint64 lastDay, qint32 famId = ALL_FAMILIES );
+
+    //*** totals for each family with records in an inclusive range of days ***
+    QMap<qint32,t_WeightTotal> getFamilyTotals( qint64 firstDay, qint64 lastDay );
+
+    //*** a family's total for each day it has records in an inclusive range, most recent first ***
+    QVector<t_DayTotal> getFamilyDays( qint32 famId, qint64 firstDay, qint64 lastDay );
+
+
+private:
+
+    //*** column data for one day ***
+    typedef struct
+    {
+        QVector<qint32> famId;
+        QVector<qint32> weight;     // hundredths of units
+        QVector<qint32> recId;
+    } t_DayColumns;
+
+    //*** loads the index file ***
+    bool loadIndex();
+
+    //*** saves the index file (atomically) ***
+    bool saveIndex();
+
+    //*** rebuilds the index by scanning the data file ***
+    bool rebuildIndex();
+
+    //*** appends one day to the archive ***
+    bool appendDay( qint64 day, const t_DayColumns &cols );
+
+    //*** reads and decodes one day from the archive ***
+    bool readDay( const t_ArchiveIndexEntry &entry, t_DayColumns &cols );
+
+    //*** decodes one block, returning the day it holds ***
+    bool decodeDay( const QByteArray &block, quint32 &day, t_DayColumns &cols );
+
+    //*** index entry for a day, -1 if not archived ***
+    int findDay( qint64 day );
+
+    //*** range of index entries for an inclusive range of days ***
+    void findRange( qint64 firstDay, qint64 lastDay, int &first, int &last );
+
+    bool isReady_;
+
+    //*** directory holding the archive files ***
+    QString path_;
+
+    //*** last error ***
+    QString lastError_;
+
+    //*** index, sorted by day ***
+    QVector<t_ArchiveIndexEntry> index_;
+
+    //*** guards the index (recursive - public functions nest) ***
+    QMutex mutex_;
+
+    //*** julian day, lowered by markChanged() without taking mutex_ ***
+    QAtomicInt coveredDay_;
+};
+
+#endif // WEIGHTARCHIVE_H
@@ -0,0 +1,186 @@
+#include "WeightSampler.h"
+#include "HX711.h"
+
+#include <stdio.h>
+#include <chrono>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::WeightSampler
+ * @param settings
+ * @param onSettled
+ */
+//*****************************************************************************
+WeightSampler::WeightSampler( const t_SettleSettings &settings, SettledFn onSettled )
+{
+    settings_  = settings;
+    onSettled_ = onSettled;
+
+    running_.store( false );
+    live_.store( 0.0f );
+
+    sleepPending_ = false;
+    wakePending_  = false;
+    idleMs_       = 0;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::~WeightSampler
+ */
+//*****************************************************************************
+WeightSampler::~WeightSampler()
+{
+    stop();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::start
+ */
+//*****************************************************************************
+void WeightSampler::start()
+{
+    if ( running_.exchange( true ) ) return;
+
+    thread_ = std::thread( &WeightSampler::run, this );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::stop
+ */
+//*****************************************************************************
+void WeightSampler::stop()
+{
+    {
+        //*** may be asleep ***
+        std::lock_guard<std::mutex> lock( mutex_ );
+        running_.store( false );
+        wakeCv_.notify_all();
+    }
+
+    //*** returns after the current weight (one filter window) ***
+    if ( thread_.joinable() ) thread_.join();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::runOnSampler
+ * @param task
+ */
+//*****************************************************************************
+void WeightSampler::runOnSampler( std::function<void()> task )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    tasks_.push_back( task );
+    wakeCv_.notify_all();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::sleep
+ */
+//*****************************************************************************
+void WeightSampler::sleep()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    sleepPending_ = true;
+    wakePending_  = false;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::wake
+ */
+//*****************************************************************************
+void WeightSampler::wake()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    sleepPending_ = false;
+    wakePending_  = true;
+    wakeCv_.notify_all();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightSampler::run
+ */
+//*****************************************************************************
+void WeightSampler::run()
+{
+SettleDetector settle( settings_ );
+std::deque<std::function<void()>> tasks;
+std::chrono::steady_clock::time_point lastActive = std::chrono::steady_clock::now();
+
+    while ( running_.load() )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex_ );
+
+            //*** asked to, or nothing on the platform for idleMs - power down until needed ***
+            bool idle = ( idleMs_ > 0 &&
+                          std::chrono::steady_clock::now() - lastActive >= std::chrono::milliseconds( idleMs_ ) );
+
+            if ( sleepPending_ || ( idle && !wakePending_ && tasks_.empty() ) )
+            {
+                sleepPending_ = false;
+
+                HX711_powerDown();
+                live_.store( 0.0f, std::memory_order_relaxed );
+                printf( "WeightSampler: idle, HX711 powered down\n" );
+
+                wakeCv_.wait( lock, [this]() { return wakePending_ || !tasks_.empty() || !running_.load(); } );
+
+                HX711_powerUp();
+                printf( "WeightSampler: HX711 powered up\n" );
+
+                //*** readings from before the sleep don't count ***
+                settle.restart();
+                lastActive = std::chrono::steady_clock::now();
+            }
+
+            //*** a wake restarts the idle time ***
+            if ( wakePending_ ) lastActive = std::chrono::steady_clock::now();
+            wakePending_ = false;
+
+            tasks.swap( tasks_ );
+        }
+
+        if ( !running_.load() ) break;
+
+        //*** tare / calibration - readings before it don't count towards settling ***
+        if ( !tasks.empty() )
+        {
+            for ( size_t i = 0; i < tasks.size(); i++ ) tasks[i]();
+            tasks.clear();
+            settle.restart();
+            lastActive = std::chrono::steady_clock::now();
+        }
+
+        float weight = HX711_getWeight();
+
+        live_.store( weight, std::memory_order_relaxed );
+
+        //*** anything on the platform keeps it awake ***
+        if ( weight >= settings_.emptyWeight ) lastActive = std::chrono::steady_clock::now();
+
+        if ( settle.add( weight ) ) onSettled_( weight );
+    }
+}
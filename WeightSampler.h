@@ -0,0 +1,82 @@
+#ifndef WEIGHTSAMPLER_H
+#define WEIGHTSAMPLER_H
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+#include "SettleDetector.h"
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The WeightSampler class
+ *
+ * Reads weights from the HX711 on its own thread and reports each settled
+ * weight once. The next weight is only reported after the platform has been
+ * emptied. Anything else that reads the HX711 (tare, calibration) is queued
+ * with runOnSampler() and run between weights. The HX711 must be initialized
+ * before start().
+ *
+ * With an idle time set, the HX711 is powered down once the platform has been
+ * empty that long, or on sleep(), and the thread waits until wake() or a
+ * queued task.
+ */
+//*****************************************************************************
+class WeightSampler
+{
+public:
+
+    //*** called on the sampler thread with each settled weight ***
+    typedef std::function<void(float weight)> SettledFn;
+
+    //*** constructor ***
+    WeightSampler( const t_SettleSettings &settings, SettledFn onSettled );
+
+    //*** destructor - stops the thread ***
+    ~WeightSampler();
+
+    //*** starts / stops the sampling thread ***
+    void start();
+    void stop();
+
+    //*** latest reading, settled or not (any thread) ***
+    float liveWeight() { return live_.load( std::memory_order_relaxed ); }
+
+    //*** runs task on the sampler thread before the next weight (any thread), wakes it ***
+    void runOnSampler( std::function<void()> task );
+
+    //*** powers down after idleMs of an empty platform, 0 never (before start) ***
+    void setIdle( int idleMs ) { idleMs_ = idleMs; }
+
+    //*** powers down after the current weight / back up (any thread) ***
+    void sleep();
+    void wake();
+
+private:
+
+    //*** sampling loop ***
+    void run();
+
+    t_SettleSettings settings_;
+    SettledFn        onSettled_;
+
+    std::thread        thread_;
+    std::atomic<bool>  running_;
+    std::atomic<float> live_;
+
+    //*** queued by runOnSampler(), sleep() and wake() (mutex_) ***
+    std::mutex                         mutex_;
+    std::condition_variable            wakeCv_;
+    std::deque<std::function<void()>>  tasks_;
+    bool                               sleepPending_;
+    bool                               wakePending_;
+
+    int idleMs_;
+};
+
+#endif // WEIGHTSAMPLER_H
@@ -0,0 +1,263 @@
+#include "WeightSink.h"
+#include "FPDB.h"
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::DBSink
+ * @param driver
+ * @param dsn
+ * @param label
+ * @param isLocal
+ * @param mode
+ * @param dayTotalField
+ * @param debounceMs
+ */
+//*****************************************************************************
+DBSink::DBSink( QString driver, QString dsn, QString label, bool isLocal, Mode mode,
+                QString dayTotalField, int debounceMs )
+{
+    driver_        = driver;
+    dsn_           = dsn;
+    label_         = label;
+    isLocal_       = isLocal;
+    mode_          = mode;
+    dayTotalField_ = dayTotalField;
+    debounceMs_    = ( mode == Cumulative ) ? debounceMs : 0;
+    db_            = Q_NULLPTR;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::~DBSink
+ */
+//*****************************************************************************
+DBSink::~DBSink()
+{
+    delete db_;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::open
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::open()
+{
+    //*** connection belongs to the thread that creates it ***
+    if ( !db_ )
+    {
+        db_ = new FPDB( driver_, dsn_, label_, isLocal_ );
+        db_->setDayTotalField( dayTotalField_ );
+    }
+
+    return db_->isReady();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::isReady
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::isReady()
+{
+    return db_ && db_->isReady();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::write
+ * @param entry
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::write( const t_WeightEntry &entry )
+{
+    if ( !isReady() ) return false;
+
+    if ( mode_ == Cumulative )
+    {
+        //*** hold - later bags for the family are added to it ***
+        if ( debounceMs_ > 0 )
+        {
+            qint64 id = ( entry.day << 32 ) | (quint32)entry.key;
+            QHash<qint64,t_WeightEntry>::iterator it = pending_.find( id );
+
+            if ( it == pending_.end() )
+            {
+                pending_.insert( id, entry );
+            }
+            else
+            {
+                it->weight += entry.weight;
+                it->total   = entry.total;
+            }
+            return true;
+        }
+
+        //*** maintain total if more than one record ***
+        return db_->addToDayTotal( entry.key, entry.weight, entry.total, entry.day );
+    }
+
+    return db_->addRecord( entry.key, entry.weight, entry.day, entry.name, entry.session, entry.seq );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::flush
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::flush()
+{
+    if ( !isReady() ) return pending_.isEmpty();
+
+    QHash<qint64,t_WeightEntry>::iterator it = pending_.begin();
+    while ( it != pending_.end() )
+    {
+        //*** keep the rest for the next try ***
+        if ( !db_->addToDayTotal( it->key, it->weight, it->total, it->day ) ) return false;
+
+        it = pending_.erase( it );
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::reopen
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::reopen()
+{
+    if ( !db_ ) return open();
+
+    return db_->reopen();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::probe
+ * @return
+ */
+//*****************************************************************************
+bool DBSink::probe()
+{
+    return db_ && db_->probe();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief DBSink::lastError
+ * @return
+ */
+//*****************************************************************************
+QString DBSink::lastError()
+{
+    return db_ ? db_->lastError() : QString( "Not opened" );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief CsvSink::CsvSink
+ * @param label
+ * @param path
+ */
+//*****************************************************************************
+CsvSink::CsvSink( QString label, QString path )
+{
+    label_     = label;
+    lastError_ = "No error";
+
+    file_.setFileName( path );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief CsvSink::open
+ * @return
+ */
+//*****************************************************************************
+bool CsvSink::open()
+{
+    if ( !file_.open( QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text ) )
+    {
+        lastError_ = file_.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief CsvSink::reopen
+ * @return
+ */
+//*****************************************************************************
+bool CsvSink::reopen()
+{
+    file_.close();
+
+    return open();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief CsvSink::write
+ * @param entry
+ * @return
+ */
+//*****************************************************************************
+bool CsvSink::write( const t_WeightEntry &entry )
+{
+QString name = entry.name;
+
+    //*** quote the name, doubling any quotes ***
+    name.replace( "\"", "\"\"" );
+
+    QByteArray line = QString( "%1,%2,%3,%4,\"%5\"\n" )
+            .arg( entry.day )
+            .arg( entry.key )
+            .arg( entry.weight, 0, 'f', 2 )
+            .arg( entry.total, 0, 'f', 2 )
+            .arg( name ).toUtf8();
+
+    //*** journal - every line goes out as it is written ***
+    if ( file_.write( line ) != line.size() || !file_.flush() )
+    {
+        lastError_ = file_.errorString();
+        return false;
+    }
+
+    return true;
+}
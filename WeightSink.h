@@ -0,0 +1,154 @@
+#ifndef WEIGHTSINK_H
+#define WEIGHTSINK_H
+
+#include <QString>
+#include <QFile>
+#include <QHash>
+
+class FPDB;
+
+
+//*** one weight to be stored, as handed to every sink ***
+typedef struct
+{
+    qint32  key;        // family ID
+    float   weight;     // weight of this bag
+    float   total;      // running total for the family
+    qint64  day;        // julian day
+    QString name;       // family name
+    quint32 session;    // scale report session and seq, seq 0 if not sequenced
+    quint32 seq;
+} t_WeightEntry;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The WeightSink class
+ *
+ * Somewhere weights are stored. Each sink is driven by its own SinkWorker, so
+ * open() and write() are always called on the sink's worker thread.
+ */
+//*****************************************************************************
+class WeightSink
+{
+public:
+
+    virtual ~WeightSink() {}
+
+    //*** name used in messages ***
+    virtual QString name() = 0;
+
+    //*** opens the sink (on the worker thread) ***
+    virtual bool open() = 0;
+
+    //*** if TRUE, sink is open and ready ***
+    virtual bool isReady() = 0;
+
+    //*** stores one weight ***
+    virtual bool write( const t_WeightEntry &entry ) = 0;
+
+    //*** tries again after open() failed or the sink was lost ***
+    virtual bool reopen() { return open(); }
+
+    //*** checks the sink still works, FALSE if it has been lost ***
+    virtual bool probe() { return isReady(); }
+
+    //*** write() may hold weights back to coalesce them - flush() is due ***
+    //*** flushDelayMs after the first one is held                        ***
+    virtual bool hasPending() { return false; }
+    virtual int  flushDelayMs() { return 0; }
+
+    //*** writes anything held, FALSE (and it is kept) if that fails ***
+    virtual bool flush() { return true; }
+
+    //*** returns string describing the last error ***
+    virtual QString lastError() = 0;
+};
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The DBSink class - stores weights through an FPDB
+ *
+ * Cumulative mode keeps a total per family per day (FPDB::addToDayTotal). With
+ * a debounce time, weights are held that long and a family's bags are added
+ * up and written once, instead of a write for each bag.
+ */
+//*****************************************************************************
+class DBSink : public WeightSink
+{
+public:
+
+    //*** per bag records, or one running total per family ***
+    enum Mode { PerBag, Cumulative };
+
+    //*** constructor - dayTotalField and debounceMs are for Cumulative (see FPDB::setDayTotalField) ***
+    DBSink( QString driver, QString dsn, QString label, bool isLocal, Mode mode,
+            QString dayTotalField = QString(), int debounceMs = 0 );
+
+    //*** destructor ***
+    ~DBSink();
+
+    QString name() { return label_; }
+    bool open();
+    bool isReady();
+    bool write( const t_WeightEntry &entry );
+    bool reopen();
+    bool probe();
+    QString lastError();
+
+    bool hasPending() { return !pending_.isEmpty(); }
+    int  flushDelayMs() { return debounceMs_; }
+    bool flush();
+
+    //*** database, once opened ***
+    FPDB *db() { return db_; }
+
+private:
+
+    QString driver_;
+    QString dsn_;
+    QString label_;
+    bool    isLocal_;
+    Mode    mode_;
+    QString dayTotalField_;
+    int     debounceMs_;
+
+    FPDB *db_;
+
+    //*** held for each family and day - weight is the sum of the bags, total the latest (Cumulative) ***
+    QHash<qint64,t_WeightEntry> pending_;
+};
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The CsvSink class - appends weights to a CSV journal file
+ */
+//*****************************************************************************
+class CsvSink : public WeightSink
+{
+public:
+
+    //*** constructor ***
+    CsvSink( QString label, QString path );
+
+    QString name() { return label_; }
+    bool open();
+    bool isReady() { return file_.isOpen(); }
+    bool write( const t_WeightEntry &entry );
+    bool reopen();
+    QString lastError() { return lastError_; }
+
+private:
+
+    QString label_;
+    QString lastError_;
+
+    QFile file_;
+};
+
+#endif // WEIGHTSINK_H
@@ -0,0 +1,272 @@
+#include "WeightTrend.h"
+
+#include <QPainter>
+#include <QTimer>
+
+#include <math.h>
+
+
+//*** space for the scale labels ***
+const int TREND_MARGIN = 4;
+const int TREND_LABEL_WIDTH = 48;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::WeightTrend
+ * @param parent
+ */
+//*****************************************************************************
+WeightTrend::WeightTrend( QWidget *parent ) : QWidget(parent)
+{
+    //*** everything is allocated here, never on a reading or a frame ***
+    times_.resize( TREND_CAPACITY );
+    values_.resize( TREND_CAPACITY );
+    points_.resize( TREND_MAX_POINTS );
+    pixels_.resize( TREND_MAX_POINTS );
+
+    head_      = 0;
+    count_     = 0;
+    numPoints_ = 0;
+    minValue_  = 0.0;
+    maxValue_  = TREND_MIN_SPAN;
+    dirty_     = false;
+
+    clock_.start();
+
+    setMinimumHeight( 80 );
+
+    frameTimer_ = new QTimer( this );
+    connect( frameTimer_, SIGNAL(timeout()), SLOT(handleFrame()) );
+    frameTimer_->start( 1000 / TREND_FPS );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::addSample
+ * @param weight
+ */
+//*****************************************************************************
+void WeightTrend::addSample( float weight )
+{
+    int tail = ( head_ + count_ ) % TREND_CAPACITY;
+
+    times_[tail]  = clock_.elapsed();
+    values_[tail] = weight;
+
+    //*** full - the oldest goes ***
+    if ( count_ < TREND_CAPACITY )
+        count_++;
+    else
+        head_ = ( head_ + 1 ) % TREND_CAPACITY;
+
+    dirty_ = true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::clear
+ */
+//*****************************************************************************
+void WeightTrend::clear()
+{
+    head_  = 0;
+    count_ = 0;
+    dirty_ = true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::handleFrame
+ */
+//*****************************************************************************
+void WeightTrend::handleFrame()
+{
+    //*** hidden (in the tray) - costs nothing ***
+    if ( !dirty_ || !isVisible() ) return;
+
+    dirty_ = false;
+
+    int plotWidth = width() - TREND_LABEL_WIDTH - 2 * TREND_MARGIN;
+
+    downsample( qBound( 0, plotWidth, TREND_MAX_POINTS ) );
+    mapPoints();
+
+    update();
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::downsample - largest triangle three buckets
+ * @param numOut - points wanted
+ */
+//*****************************************************************************
+void WeightTrend::downsample( int numOut )
+{
+int a = 0;
+int out = 0;
+
+    //*** too narrow to draw anything ***
+    numPoints_ = 0;
+    if ( count_ == 0 || numOut < 3 ) return;
+
+    //*** few enough already ***
+    if ( count_ <= numOut )
+    {
+        for ( int i = 0; i < count_; i++ )
+        {
+            points_[out++] = QPointF( timeAt( i ), valueAt( i ) );
+        }
+        numPoints_ = out;
+    }
+    else
+    {
+        //*** first and last are kept, the rest split into numOut - 2 buckets ***
+        double every = (double)( count_ - 2 ) / (double)( numOut - 2 );
+
+        points_[out++] = QPointF( timeAt( 0 ), valueAt( 0 ) );
+
+        for ( int b = 0; b < numOut - 2; b++ )
+        {
+            //*** average of the next bucket is the third corner ***
+            int nextStart = (int)floor( ( b + 1 ) * every ) + 1;
+            int nextEnd   = qMin( (int)floor( ( b + 2 ) * every ) + 1, count_ );
+            double avgT = 0.0, avgV = 0.0;
+
+            for ( int i = nextStart; i < nextEnd; i++ )
+            {
+                avgT += timeAt( i );
+                avgV += valueAt( i );
+            }
+
+            int nextCount = nextEnd - nextStart;
+            if ( nextCount > 0 )
+            {
+                avgT /= nextCount;
+                avgV /= nextCount;
+            }
+            else
+            {
+                avgT = timeAt( count_ - 1 );
+                avgV = valueAt( count_ - 1 );
+            }
+
+            //*** point in this bucket making the largest triangle with the last pick ***
+            int start = (int)floor( b * every ) + 1;
+            int end   = (int)floor( ( b + 1 ) * every ) + 1;
+            double aT = timeAt( a ), aV = valueAt( a );
+            double maxArea = -1.0;
+            int pick = start;
+
+            for ( int i = start; i < end; i++ )
+            {
+                double area = fabs( ( aT - avgT ) * ( valueAt( i ) - aV ) - ( aT - timeAt( i ) ) * ( avgV - aV ) );
+                if ( area > maxArea )
+                {
+                    maxArea = area;
+                    pick = i;
+                }
+            }
+
+            points_[out++] = QPointF( timeAt( pick ), valueAt( pick ) );
+            a = pick;
+        }
+
+        points_[out++] = QPointF( timeAt( count_ - 1 ), valueAt( count_ - 1 ) );
+        numPoints_ = out;
+    }
+
+    //*** vertical range of what is drawn ***
+    minValue_ = maxValue_ = points_[0].y();
+    for ( int i = 1; i < numPoints_; i++ )
+    {
+        minValue_ = qMin( minValue_, points_[i].y() );
+        maxValue_ = qMax( maxValue_, points_[i].y() );
+    }
+
+    if ( maxValue_ - minValue_ < TREND_MIN_SPAN )
+    {
+        double mid = ( maxValue_ + minValue_ ) / 2.0;
+        minValue_ = mid - TREND_MIN_SPAN / 2.0;
+        maxValue_ = mid + TREND_MIN_SPAN / 2.0;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::mapPoints
+ */
+//*****************************************************************************
+void WeightTrend::mapPoints()
+{
+    if ( numPoints_ == 0 ) return;
+
+    QRectF plot( TREND_LABEL_WIDTH + TREND_MARGIN, TREND_MARGIN,
+                 width() - TREND_LABEL_WIDTH - 2 * TREND_MARGIN, height() - 2 * TREND_MARGIN );
+
+    double t0 = points_[0].x();
+    double tSpan = qMax( points_[numPoints_-1].x() - t0, 1.0 );
+    double vSpan = maxValue_ - minValue_;
+
+    for ( int i = 0; i < numPoints_; i++ )
+    {
+        pixels_[i].setX( plot.left() + ( points_[i].x() - t0 ) / tSpan * plot.width() );
+        pixels_[i].setY( plot.bottom() - ( points_[i].y() - minValue_ ) / vSpan * plot.height() );
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::resizeEvent
+ * @param event
+ */
+//*****************************************************************************
+void WeightTrend::resizeEvent( QResizeEvent *event )
+{
+    QWidget::resizeEvent( event );
+
+    //*** new width, new number of points ***
+    dirty_ = true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief WeightTrend::paintEvent
+ * @param event
+ */
+//*****************************************************************************
+void WeightTrend::paintEvent( QPaintEvent * )
+{
+QPainter painter( this );
+
+    painter.fillRect( rect(), palette().base() );
+
+    if ( numPoints_ == 0 ) return;
+
+    //*** scale ***
+    painter.setPen( palette().color( QPalette::Mid ) );
+    painter.drawText( QRect( 0, TREND_MARGIN, TREND_LABEL_WIDTH, 20 ),
+                      Qt::AlignRight | Qt::AlignTop, QString::number( maxValue_, 'f', 2 ) );
+    painter.drawText( QRect( 0, height() - TREND_MARGIN - 20, TREND_LABEL_WIDTH, 20 ),
+                      Qt::AlignRight | Qt::AlignBottom, QString::number( minValue_, 'f', 2 ) );
+
+    //*** trend ***
+    painter.setRenderHint( QPainter::Antialiasing );
+    painter.setPen( QPen( palette().color( QPalette::Highlight ), 1.5 ) );
+    painter.drawPolyline( pixels_.constData(), numPoints_ );
+}
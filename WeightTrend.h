@@ -0,0 +1,95 @@
+#ifndef WEIGHTTREND_H
+#define WEIGHTTREND_H
+
+#include <QWidget>
+#include <QVector>
+#include <QPointF>
+#include <QElapsedTimer>
+
+class QTimer;
+
+
+//*** live readings kept (10 minutes at 15 Hz) ***
+const int TREND_CAPACITY = 9000;
+
+//*** most points drawn, however wide the view ***
+const int TREND_MAX_POINTS = 1024;
+
+//*** redraws per second while visible ***
+const int TREND_FPS = 5;
+
+//*** smallest weight span shown, so noise on an empty scale isn't blown up ***
+const double TREND_MIN_SPAN = 1.0;
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief The WeightTrend class
+ *
+ * Trend of the live weight. Readings go into a fixed ring, so adding one
+ * never allocates. A timer redraws at most TREND_FPS times a second, and
+ * only while visible, with the ring downsampled by LTTB (largest triangle
+ * three buckets) to about one point per pixel. The draw cost doesn't
+ * depend on how long it has run or how fast readings come in.
+ */
+//*****************************************************************************
+class WeightTrend : public QWidget
+{
+    Q_OBJECT
+
+public:
+
+    //*** constructor ***
+    explicit WeightTrend( QWidget *parent = nullptr );
+
+    //*** adds a reading, timed now ***
+    void addSample( float weight );
+
+    //*** empties the ring ***
+    void clear();
+
+    QSize sizeHint() const override { return QSize( 400, 120 ); }
+
+protected:
+
+    void paintEvent( QPaintEvent *event ) override;
+    void resizeEvent( QResizeEvent *event ) override;
+
+private slots:
+
+    //*** downsamples and repaints if anything changed ***
+    void handleFrame();
+
+private:
+
+    //*** reading at logical index i, oldest first ***
+    double timeAt( int i ) const { return times_[ ( head_ + i ) % TREND_CAPACITY ]; }
+    double valueAt( int i ) const { return values_[ ( head_ + i ) % TREND_CAPACITY ]; }
+
+    //*** LTTB of the ring into points_ (time, weight) ***
+    void downsample( int numOut );
+
+    //*** points_ to widget coordinates in pixels_ ***
+    void mapPoints();
+
+    //*** ring, oldest at head_ ***
+    QVector<qint64> times_;
+    QVector<float>  values_;
+    int             head_;
+    int             count_;
+
+    QElapsedTimer clock_;
+
+    //*** downsampled and mapped, sized once ***
+    QVector<QPointF> points_;
+    QVector<QPointF> pixels_;
+    int              numPoints_;
+    double           minValue_;
+    double           maxValue_;
+
+    QTimer *frameTimer_;
+    bool    dirty_;
+};
+
+#endif // WEIGHTTREND_H
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT += core gui network sql widgets
+QT += core gui network sql widgets concurrent
 
 TARGET = fpSvr
 TEMPLATE = app
@@ -25,11 +25,30 @@ CONFIG += c++11
 SOURCES += \
         main.cpp \
         FpWindow.cpp \
-    FPDB.cpp
+    FPDB.cpp \
+    WeightArchive.cpp \
+    WeightSink.cpp \
+    SinkWorker.cpp \
+    FpConfig.cpp \
+    LiveWeightReceiver.cpp \
+    FamilyRoster.cpp \
+    EventLog.cpp \
+    ScaleLink.cpp \
+    WeightTrend.cpp
 
 HEADERS += \
         FpWindow.h \
-    FPDB.h
+    FPDB.h \
+    WeightArchive.h \
+    WeightSink.h \
+    SinkWorker.h \
+    FpConfig.h \
+    FpMessages.h \
+    LiveWeightReceiver.h \
+    FamilyRoster.h \
+    EventLog.h \
+    ScaleLink.h \
+    WeightTrend.h
 
 FORMS += \
         FpWindow.ui
@@ -0,0 +1,299 @@
+//*****************************************************************************
+//*** hx711replay - re-derives weights from raw HX711 captures with a new   ***
+//*** tare / scale. Runs the same filter and settle detection as scaled.    ***
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "HX711Raw.h"
+#include "SettleDetector.h"
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief usage
+ */
+//*****************************************************************************
+static void usage( const char *prog )
+{
+    printf( "Usage: %s [-t tare] [-s scale | -r refRaw refWeight] [-S min,empty,tolerance,count] [-a] capture ...\n", prog );
+    printf( "  -t  raw tare (default: the tare each weight was taken with)\n" );
+    printf( "  -s  scale factor (default: the scale each weight was taken with)\n" );
+    printf( "  -r  scale from a raw reading of a reference weight (needs -t)\n" );
+    printf( "  -S  settle settings, as [settle] in scaled.ini (default 0.5,0.2,0.05,4)\n" );
+    printf( "  -a  every weight, not just settled ones\n" );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief extendSamples - raw 24 bit samples to the driver's values (sign extended, negated)
+ * @param in
+ * @param out
+ * @param numSamples
+ */
+//*****************************************************************************
+static void extendSamples( const HX711_CaptureSample *in, int32_t *out, size_t numSamples )
+{
+size_t i = 0;
+
+#if defined(__SSE2__)
+const __m128i zero = _mm_setzero_si128();
+
+    for ( ; i + 4 <= numSamples; i += 4 )
+    {
+        //*** { raw, offset } pairs - gather the four raw values ***
+        __m128i a = _mm_loadu_si128( (const __m128i *)&in[i] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&in[i+2] );
+        a = _mm_shuffle_epi32( a, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        b = _mm_shuffle_epi32( b, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        __m128i v = _mm_unpacklo_epi64( a, b );
+
+        //*** bit 23 into the sign, then negate ***
+        v = _mm_srai_epi32( _mm_slli_epi32( v, 8 ), 8 );
+        v = _mm_sub_epi32( zero, v );
+
+        _mm_storeu_si128( (__m128i *)&out[i], v );
+    }
+#endif
+
+    for ( ; i < numSamples; i++ )
+    {
+        int32_t val = (int32_t)( in[i].raw << 8 ) >> 8;
+        out[i] = -val;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief toWeights - ( sample - tare ) * scale, exactly as the driver does it
+ * @param in
+ * @param out
+ * @param numSamples
+ * @param tare
+ * @param scale
+ */
+//*****************************************************************************
+static void toWeights( const int32_t *in, double *out, size_t numSamples, int tare, double scale )
+{
+size_t i = 0;
+
+#if defined(__SSE2__)
+const __m128d tareV  = _mm_set1_pd( (double)tare );
+const __m128d scaleV = _mm_set1_pd( scale );
+
+    for ( ; i + 2 <= numSamples; i += 2 )
+    {
+        __m128d v = _mm_cvtepi32_pd( _mm_loadl_epi64( (const __m128i *)&in[i] ) );
+        _mm_storeu_pd( &out[i], _mm_mul_pd( _mm_sub_pd( v, tareV ), scaleV ) );
+    }
+#endif
+
+    for ( ; i < numSamples; i++ )
+    {
+        out[i] = ( (double)in[i] - (double)tare ) * scale;
+    }
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief nowNSec
+ * @return
+ */
+//*****************************************************************************
+static long long nowNSec()
+{
+struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief replay - re-derives and prints the weights of one capture file
+ * @param path
+ * @param tare - INT32_MIN to use each record's tare
+ * @param scale - 0 to use each record's scale
+ * @param settle
+ * @param all
+ * @param numWeights - weights re-derived
+ * @param numSamples - samples converted
+ * @return
+ */
+//*****************************************************************************
+static bool replay( const char *path, int tare, double scale, const t_SettleSettings &settle, bool all,
+                    long long &numWeights, long long &numSamples )
+{
+HX711_Capture capture;
+std::vector<int32_t> data;
+std::vector<double> weights;
+SettleDetector detector( settle );
+char stamp[32];
+struct tm tmRec;
+
+    if ( !HX711_readCapture( path, capture ) )
+    {
+        fprintf( stderr, "hx711replay: unable to read %s\n", path );
+        return false;
+    }
+
+    if ( capture.numSkipped > 0 )
+    {
+        fprintf( stderr, "hx711replay: %s : %lld byte(s) skipped\n", path, capture.numSkipped );
+    }
+
+    //*** sign extension for the whole file in one pass ***
+    data.resize( capture.samples.size() );
+    if ( !data.empty() ) extendSamples( &capture.samples[0], &data[0], data.size() );
+
+    weights.resize( HX711_CAPTURE_MAX_SAMPLES );
+
+    for ( size_t r = 0; r < capture.records.size(); r++ )
+    {
+        const HX711_CaptureRecord &rec = capture.records[r];
+        int32_t *samples = &data[capture.sampleIndex[r]];
+        int      count   = rec.numSamples;
+
+        //*** same filter as HX711_getWeight ***
+        HX711_rejectOutliers( samples, count );
+
+        toWeights( samples, &weights[0], count,
+                   ( tare != INT32_MIN ) ? tare : rec.tare,
+                   ( scale != 0.0 ) ? scale : rec.scale );
+
+        double total = 0;
+        for ( int i = 0; i < count; i++ ) total += weights[i];
+
+        float weight = (float)( total / (double)count );
+        if ( weight < 0 ) weight = 0;
+
+        bool settled = detector.add( weight );
+
+        if ( settled || all )
+        {
+            time_t secs = (time_t)( rec.time / 1000000000LL );
+            localtime_r( &secs, &tmRec );
+            strftime( stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tmRec );
+
+            printf( "%s,%.2f,%.2f%s\n", stamp, rec.weight, weight, all ? ( settled ? ",settled" : "," ) : "" );
+        }
+    }
+
+    numWeights += capture.records.size();
+    numSamples += capture.samples.size();
+
+    return true;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief main
+ * @param argc
+ * @param argv
+ * @return
+ */
+//*****************************************************************************
+int main( int argc, char *argv[] )
+{
+int tare = INT32_MIN;
+double scale = 0.0;
+int refRaw = 0;
+double refWeight = 0.0;
+bool all = false;
+t_SettleSettings settle = { 0.5f, 0.2f, 0.05f, 4 };
+std::vector<const char *> files;
+long long numWeights = 0;
+long long numSamples = 0;
+int rtn = 0;
+
+    //*** command line ***
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "-t" ) && i + 1 < argc )
+        {
+            tare = atoi( argv[++i] );
+        }
+        else if ( !strcmp( argv[i], "-s" ) && i + 1 < argc )
+        {
+            scale = strtod( argv[++i], NULL );
+        }
+        else if ( !strcmp( argv[i], "-r" ) && i + 2 < argc )
+        {
+            refRaw    = atoi( argv[++i] );
+            refWeight = strtod( argv[++i], NULL );
+        }
+        else if ( !strcmp( argv[i], "-S" ) && i + 1 < argc )
+        {
+            if ( sscanf( argv[++i], "%f,%f,%f,%d", &settle.minWeight, &settle.emptyWeight,
+                         &settle.tolerance, &settle.settleCount ) != 4 )
+            {
+                usage( argv[0] );
+                return 1;
+            }
+        }
+        else if ( !strcmp( argv[i], "-a" ) )
+        {
+            all = true;
+        }
+        else if ( argv[i][0] == '-' )
+        {
+            usage( argv[0] );
+            return 1;
+        }
+        else
+        {
+            files.push_back( argv[i] );
+        }
+    }
+
+    if ( files.empty() )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    //*** as HX711_setCalibrationData ***
+    if ( refWeight != 0.0 )
+    {
+        if ( tare == INT32_MIN || refRaw == tare )
+        {
+            fprintf( stderr, "hx711replay: -r needs -t, and a reference reading away from the tare\n" );
+            return 1;
+        }
+
+        scale = refWeight / ( (double)refRaw - (double)tare );
+    }
+
+    long long start = nowNSec();
+
+    for ( size_t i = 0; i < files.size(); i++ )
+    {
+        if ( !replay( files[i], tare, scale, settle, all, numWeights, numSamples ) ) rtn = 1;
+    }
+
+    fprintf( stderr, "hx711replay: %lld weight(s), %lld sample(s) in %.1f ms\n",
+             numWeights, numSamples, ( nowNSec() - start ) / 1000000.0 );
+
+    return rtn;
+}
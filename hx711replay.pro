@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# hx711replay - re-derives weights from raw HX711 captures, no hardware needed
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = hx711replay
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    hx711replay.cpp \
+    HX711Raw.cpp \
+    SettleDetector.cpp
+
+HEADERS += \
+    HX711Raw.h \
+    SettleDetector.h
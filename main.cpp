@@ -1,10 +1,210 @@
 #include "FpWindow.h"
+#include "FpConfig.h"
+#include "EventLog.h"
+#include "FPDB.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFile>
+#include <QDate>
+#include <string.h>
+#include <stdio.h>
+#include <limits>
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief addConsoleOptions - options that run without the window
+ * @param parser
+ */
+//*****************************************************************************
+static void addConsoleOptions( QCommandLineParser &parser )
+{
+    parser.addOption( QCommandLineOption( "decode-log", "Write a binary event log out as text and exit.", "file" ) );
+    parser.addOption( QCommandLineOption( "export", "Export local weight records (csv or json lines) and exit.", "format" ) );
+    parser.addOption( QCommandLineOption( "from", "First day to export (yyyy-MM-dd).", "date" ) );
+    parser.addOption( QCommandLineOption( "to", "Last day to export (yyyy-MM-dd).", "date" ) );
+    parser.addOption( QCommandLineOption( "family", "Export one family only.", "id" ) );
+    parser.addOption( QCommandLineOption( "out", "Export file (default stdout).", "file" ) );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief isOption - "--name" or "--name=value"
+ * @param arg
+ * @param name
+ * @return
+ */
+//*****************************************************************************
+static bool isOption( const char *arg, const char *name )
+{
+size_t len = strlen( name );
+
+    if ( strncmp( arg, "--", 2 ) || strncmp( arg + 2, name, len ) ) return false;
+
+    return arg[len + 2] == '\0' || arg[len + 2] == '=';
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief runDecodeLog - writes a binary event log to stdout as text
+ * @param argc
+ * @param argv
+ * @return
+ */
+//*****************************************************************************
+static int runDecodeLog( int argc, char *argv[] )
+{
+QCoreApplication c(argc, argv);
+QTextStream out( stdout );
+
+    c.setApplicationName( "fpSvr" );
+
+    //*** same options as the window, so a missing file name is reported ***
+    FpConfig config;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    config.addOptions( parser );
+    addConsoleOptions( parser );
+    parser.process( c );
+
+    return EventLog::decode( parser.value( "decode-log" ), out ) ? 0 : 1;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief runExport - streams the local database out, never loading it whole
+ * @param argc
+ * @param argv
+ * @return
+ */
+//*****************************************************************************
+static int runExport( int argc, char *argv[] )
+{
+QCoreApplication c(argc, argv);
+QTextStream err( stderr );
+QFile out;
+
+    c.setApplicationName( "fpSvr" );
+
+    FpConfig config;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    config.addOptions( parser );
+    addConsoleOptions( parser );
+    parser.process( c );
+    config.parse( parser );
+
+    //*** what to export ***
+    QString fmt = parser.value( "export" ).toLower();
+    if ( fmt != "csv" && fmt != "json" )
+    {
+        err << "--export must be csv or json\n";
+        return 1;
+    }
+
+    qint64 firstDay = 0;
+    qint64 lastDay  = std::numeric_limits<qint64>::max();
+    qint32 famId    = ALL_FAMILIES;
+
+    if ( parser.isSet( "from" ) )
+    {
+        QDate date = QDate::fromString( parser.value( "from" ), Qt::ISODate );
+        if ( !date.isValid() ) { err << "Bad --from date\n"; return 1; }
+        firstDay = date.toJulianDay();
+    }
+
+    if ( parser.isSet( "to" ) )
+    {
+        QDate date = QDate::fromString( parser.value( "to" ), Qt::ISODate );
+        if ( !date.isValid() ) { err << "Bad --to date\n"; return 1; }
+        lastDay = date.toJulianDay();
+    }
+
+    if ( parser.isSet( "family" ) )
+    {
+        bool ok;
+        famId = parser.value( "family" ).toInt( &ok );
+        if ( !ok ) { err << "Bad --family id\n"; return 1; }
+    }
+
+    //*** where to ***
+    bool opened;
+    if ( parser.isSet( "out" ) )
+    {
+        out.setFileName( parser.value( "out" ) );
+        opened = out.open( QIODevice::WriteOnly | QIODevice::Truncate );
+    }
+    else
+    {
+        opened = out.open( stdout, QIODevice::WriteOnly );
+    }
+
+    if ( !opened )
+    {
+        err << "Can't open output : " << out.errorString() << "\n";
+        return 1;
+    }
+
+    //*** read only - the server may have it open, and it is not changed ***
+    FPDB db( "QSQLITE", config.getString( CFG_LOCAL_DB_PATH ), "export", true, true );
+    if ( !db.isReady() )
+    {
+        err << "Can't open " << config.getString( CFG_LOCAL_DB_PATH ) << " : " << db.lastError() << "\n";
+        return 1;
+    }
+
+    qint64 rows = db.exportRecords( &out, fmt == "json" ? EXPORT_JSON : EXPORT_CSV, firstDay, lastDay, famId );
+    if ( rows < 0 )
+    {
+        err << "Export failed : " << db.lastError() << "\n";
+        return 1;
+    }
+
+    err << rows << " record(s) exported\n";
+
+    return 0;
+}
+
 
 int main(int argc, char *argv[])
 {
+    //*** console modes - no window needed (their parsers report a missing value) ***
+    for ( int i = 1; i < argc && strcmp( argv[i], "--" ); i++ )
+    {
+        //*** decode a binary event log to stdout ***
+        if ( isOption( argv[i], "decode-log" ) )
+        {
+            return runDecodeLog( argc, argv );
+        }
+
+        if ( isOption( argv[i], "export" ) )
+        {
+            return runExport( argc, argv );
+        }
+    }
+
     QApplication a(argc, argv);
-    FpWindow w;
+    a.setApplicationName( "fpSvr" );
+
+    //*** command line and config file ***
+    FpConfig config;
+    QCommandLineParser parser;
+    parser.setApplicationDescription( "Checkin Server" );
+    parser.addHelpOption();
+    config.addOptions( parser );
+    addConsoleOptions( parser );
+    parser.process( a );
+    config.parse( parser );
+
+    FpWindow w( &config );
     w.show();
 
     return a.exec();
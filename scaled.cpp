@@ -0,0 +1,266 @@
+//*****************************************************************************
+//*** scaled - scale server. Owns the HX711, takes check-ins from fpSvr and ***
+//*** reports settled weights for the family at the scale.                  ***
+//*****************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <math.h>
+#include <string>
+
+#include <wiringPi.h>
+
+#include "HX711.h"
+#include "ScaleConfig.h"
+#include "ScaleServer.h"
+#include "WeightSampler.h"
+#include "LivePublisher.h"
+
+//*** default config file ***
+const char *DEFAULT_CONFIG_FILE = "/etc/scaled.ini";
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief usage
+ */
+//*****************************************************************************
+static void usage( const char *prog )
+{
+    printf( "Usage: %s [-c config.ini] [-s section/key=value ...]\n", prog );
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief tareScale - takes the current reading as zero (sampler thread)
+ * @param reading - weight read afterwards
+ * @return - COMMAND_* status
+ */
+//*****************************************************************************
+static int32_t tareScale( float &reading )
+{
+    //*** asked for - whatever is there is zero ***
+    if ( HX711_verifyTare( 8, INT_MAX, 2000 ) != HX711_TARE_OK ) return COMMAND_FAILED;
+
+    reading = HX711_getWeight();
+
+    return COMMAND_OK;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief calibrateScale - takes the current reading as refWeight (sampler thread)
+ * @param refWeight
+ * @param calFile
+ * @param cellId
+ * @param reading - weight read afterwards
+ * @return - COMMAND_* status
+ */
+//*****************************************************************************
+static int32_t calibrateScale( float refWeight, const std::string &calFile, const std::string &cellId, float &reading )
+{
+int tare;
+double scale;
+
+    if ( refWeight <= 0 ) return COMMAND_REFUSED;
+
+    HX711_getCalibrationData( tare, scale );
+
+    //*** raw reading of the reference weight, from the filtered weight ***
+    float weight = HX711_getWeight();
+    if ( weight <= 0 || scale == 0 ) return COMMAND_FAILED;
+
+    HX711_setCalibrationData( tare, tare + (int)lround( weight / scale ), refWeight );
+
+    if ( !HX711_saveCalibration( calFile.c_str(), cellId.c_str() ) )
+    {
+        printf( "scaled: unable to save calibration to %s\n", calFile.c_str() );
+    }
+
+    reading = HX711_getWeight();
+
+    return COMMAND_OK;
+}
+
+
+//*****************************************************************************
+//*****************************************************************************
+/**
+ * @brief main
+ * @param argc
+ * @param argv
+ * @return
+ */
+//*****************************************************************************
+int main( int argc, char *argv[] )
+{
+ScaleConfig config;
+std::string configFile = DEFAULT_CONFIG_FILE;
+std::string overrides;
+HX711_RtOptions rt;
+HX711_AutoZero az;
+t_SettleSettings settle;
+sigset_t mask;
+
+    //*** command line ***
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "-c" ) && i + 1 < argc )
+        {
+            configFile = argv[++i];
+        }
+        else if ( !strcmp( argv[i], "-s" ) && i + 1 < argc )
+        {
+            overrides += std::string( argv[++i] ) + "\n";
+        }
+        else
+        {
+            usage( argv[0] );
+            return 1;
+        }
+    }
+
+    if ( !config.load( configFile ) )
+    {
+        printf( "scaled: no config file %s, using defaults\n", configFile.c_str() );
+    }
+
+    //*** overrides win over the file ***
+    size_t start = 0, end;
+    while ( ( end = overrides.find( '\n', start ) ) != std::string::npos )
+    {
+        std::string item = overrides.substr( start, end - start );
+        size_t eq = item.find( '=' );
+        if ( eq != std::string::npos ) config.set( item.substr( 0, eq ), item.substr( eq + 1 ) );
+        start = end + 1;
+    }
+
+    //*** stop signals go to the server's signalfd - block before any threads ***
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGINT );
+    sigaddset( &mask, SIGTERM );
+    pthread_sigmask( SIG_BLOCK, &mask, NULL );
+
+    //*** GPIO backend ***
+    std::string backend = config.getString( "hx711/backend", "wiringpi" );
+
+    if ( backend == "cdev" )
+    {
+        HX711_setBackend( HX711_BACKEND_GPIO_CDEV, config.getString( "hx711/chip", "/dev/gpiochip0" ).c_str() );
+    }
+    else
+    {
+        wiringPiSetup();
+        HX711_setBackend( HX711_BACKEND_WIRINGPI, NULL );
+    }
+
+    //*** real time sampling ***
+    rt.priority   = config.getInt( "rt/priority", 0 );
+    rt.cpu        = config.getInt( "rt/cpu", -1 );
+    rt.lockMemory = config.getBool( "rt/lockMemory", false );
+    HX711_setRealtime( rt );
+
+    //*** HX711 ***
+    std::string calFile = config.getString( "hx711/calibrationFile", "/var/lib/scaled/hx711.cal" );
+    std::string cellId  = config.getString( "hx711/cellId", "scale" );
+
+    HX711_setSamplesPerWeight( config.getInt( "hx711/samplesPerWeight", 8 ) );
+
+    //*** raw samples for offline recalibration (hx711replay), empty - off ***
+    HX711_setCapture( config.getString( "hx711/captureFile", "" ).c_str() );
+
+    if ( !HX711_initFromProfile( config.getInt( "hx711/dtPin", 0 ), config.getInt( "hx711/sckPin", 1 ),
+                                 calFile.c_str(), cellId.c_str(),
+                                 config.getInt( "hx711/defaultTare", 0 ),
+                                 config.getDouble( "hx711/defaultScale", 1.0 ) ) )
+    {
+        printf( "scaled: HX711 init failed\n" );
+        return 1;
+    }
+
+    if ( HX711_verifyTare( 8, config.getInt( "hx711/verifyTolerance", 2000 ), 2000 ) == HX711_TARE_TIMEOUT )
+    {
+        printf( "scaled: no conversions from the HX711\n" );
+        HX711_shutdown();
+        return 1;
+    }
+
+    HX711_getAutoZero( az );
+    az.enabled = config.getBool( "hx711/autoZero", az.enabled );
+    HX711_setAutoZero( az );
+
+    //*** network ***
+    ScaleServer server;
+
+    if ( !server.start( config.getInt( "scale/port", 29456 ), config.getInt( "scale/window", 32 ) ) )
+    {
+        HX711_shutdown();
+        return 1;
+    }
+
+    //*** sampling thread - settled weights go to the server loop ***
+    settle.minWeight   = config.getDouble( "settle/minWeight", 0.5 );
+    settle.emptyWeight = config.getDouble( "settle/emptyWeight", 0.2 );
+    settle.tolerance   = config.getDouble( "settle/tolerance", 0.05 );
+    settle.settleCount = config.getInt( "settle/count", 4 );
+
+    WeightSampler sampler( settle, [&server]( float weight ) { server.postWeight( weight ); } );
+
+    //*** powers the HX711 down while the platform stays empty, 0 never ***
+    sampler.setIdle( config.getInt( "hx711/idleMs", 0 ) );
+
+    //*** a family on the way to the scale ***
+    server.setCheckInHandler( [&sampler]() { sampler.wake(); } );
+
+    //*** tare / calibrate from fpSvr - run between weights, result back through the loop ***
+    server.setCommandHandler( [&]( uint32_t type, float value )
+    {
+        if ( type == (uint32_t)SCALE_SLEEP_TYPE || type == (uint32_t)SCALE_WAKE_TYPE )
+        {
+            if ( type == (uint32_t)SCALE_SLEEP_TYPE ) sampler.sleep();
+            else                                      sampler.wake();
+
+            server.postResult( type, COMMAND_OK, 0.0f );
+            return;
+        }
+
+        sampler.runOnSampler( [&server, &calFile, &cellId, type, value]()
+        {
+            float   reading = 0.0f;
+            int32_t status;
+
+            if ( type == (uint32_t)SCALE_TARE_TYPE ) status = tareScale( reading );
+            else                                     status = calibrateScale( value, calFile, cellId, reading );
+
+            printf( "scaled: command %u status %d, reading %.2f\n", type, status, reading );
+
+            server.postResult( type, status, reading );
+        } );
+    } );
+
+    //*** live weight - the sampler only stores it, the loop sends it ***
+    LivePublisher live;
+    std::string group = config.getString( "live/group", "239.255.41.1" );
+
+    if ( !group.empty() &&
+         live.open( group, config.getInt( "live/port", 29458 ), config.getInt( "live/ttl", 1 ),
+                    config.getString( "live/interface", "" ) ) )
+    {
+        server.startLive( &live, [&sampler]() { return sampler.liveWeight(); }, config.getInt( "live/rateHz", 15 ) );
+    }
+
+    sampler.start();
+    server.run();
+    sampler.stop();
+
+    HX711_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# scaled - scale server, runs on the Pi with the HX711
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+TARGET = scaled
+
+CONFIG += console c++11
+CONFIG -= qt app_bundle
+
+LIBS += -lwiringPi -lpthread
+
+SOURCES += \
+    scaled.cpp \
+    ScaleServer.cpp \
+    ScaleConfig.cpp \
+    WeightSampler.cpp \
+    SettleDetector.cpp \
+    HX711.cpp \
+    HX711Raw.cpp \
+    GpioCdev.cpp \
+    LivePublisher.cpp
+
+HEADERS += \
+    ScaleServer.h \
+    ScaleConfig.h \
+    WeightSampler.h \
+    SettleDetector.h \
+    FpMessages.h \
+    HX711.h \
+    HX711Raw.h \
+    GpioCdev.h \
+    LivePublisher.h
+
+# Default rules for deployment.
+unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target